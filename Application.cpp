@@ -123,6 +123,16 @@ int Application::run()
 		//fail();
 	}
 
+	// Report the memory footprint, ring share, operation latency, transfers and anti-entropy of every KV store
+	for ( i = 0; i <= par->EN_GPSZ-1; i++ ) {
+		mp2[i]->logMemoryFootprint();
+		mp2[i]->logLoadDistribution();
+		mp2[i]->logOperationLatency();
+		mp2[i]->logHintedHandoff();
+		mp2[i]->logTransfers();
+		mp2[i]->logAntiEntropy();
+	}
+
 	// Clean up
 	en->ENcleanup();
 	en1->ENcleanup();
@@ -436,7 +446,7 @@ void Application::insertTestKVPairs() {
 
 		// Step 2. Issue a create operation
 		log->LOG(&mp2[number]->getMemberNode()->addr, "CREATE OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), it->second.c_str(), par->getcurrtime());
-		mp2[number]->clientCreate(it->first, it->second);
+		mp2[number]->clientCreate(it->first, it->second, par->KEY_TTL);
 	}
 
 	cout<<endl<<"Sent " <<testKVPairs.size() <<" create messages to the ring"<<endl;
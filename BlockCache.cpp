@@ -0,0 +1,90 @@
+/**********************************
+ * FILE NAME: BlockCache.cpp
+ *
+ * DESCRIPTION: Definition of the BlockCache class
+ **********************************/
+
+#include "BlockCache.h"
+
+/**
+ * constructor
+ */
+BlockCache::BlockCache(size_t capacity): capacity(capacity), usage(0), hits(0), misses(0) {}
+
+/**
+ * Destructor
+ */
+BlockCache::~BlockCache() {}
+
+/**
+ * FUNCTION NAME: cacheKey
+ *
+ * DESCRIPTION: One 64-bit key per block: table id in the high bits, block number in the low 24
+ */
+uint64_t BlockCache::cacheKey(uint64_t tableId, uint32_t block) {
+	return (tableId << 24) | (block & 0xFFFFFF);
+}
+
+/**
+ * FUNCTION NAME: lookup
+ *
+ * DESCRIPTION: Return the cached block and mark it most recently used
+ *
+ * RETURNS:
+ * the block contents, or an empty pointer on a miss
+ */
+shared_ptr<const string> BlockCache::lookup(uint64_t tableId, uint32_t block) {
+	lock_guard<mutex> guard(lock);
+	auto search = items.find(cacheKey(tableId, block));
+	if ( search == items.end() ) {
+		misses++;
+		return shared_ptr<const string>();
+	}
+	hits++;
+	lru.splice(lru.begin(), lru, search->second);
+	return search->second->second;
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Cache a block, evicting least recently used blocks to stay within capacity.
+ * 				Readers still holding an evicted block keep it alive until they are done.
+ */
+void BlockCache::insert(uint64_t tableId, uint32_t block, const shared_ptr<const string> &contents) {
+	lock_guard<mutex> guard(lock);
+	uint64_t key = cacheKey(tableId, block);
+	if ( items.count(key) != 0 || contents->size() > capacity ) {
+		return;
+	}
+	lru.emplace_front(key, contents);
+	items[key] = lru.begin();
+	usage += contents->size();
+	while ( usage > capacity ) {
+		usage -= lru.back().second->size();
+		items.erase(lru.back().first);
+		lru.pop_back();
+	}
+}
+
+void BlockCache::clear() {
+	lock_guard<mutex> guard(lock);
+	lru.clear();
+	items.clear();
+	usage = 0;
+}
+
+size_t BlockCache::getUsage() {
+	lock_guard<mutex> guard(lock);
+	return usage;
+}
+
+unsigned long BlockCache::getHits() {
+	lock_guard<mutex> guard(lock);
+	return hits;
+}
+
+unsigned long BlockCache::getMisses() {
+	lock_guard<mutex> guard(lock);
+	return misses;
+}
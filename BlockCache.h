@@ -0,0 +1,45 @@
+/**********************************
+ * FILE NAME: BlockCache.h
+ *
+ * DESCRIPTION: Header file of the BlockCache class
+ **********************************/
+
+#ifndef BLOCKCACHE_H_
+#define BLOCKCACHE_H_
+
+#include "stdincludes.h"
+#include <list>
+#include <memory>
+#include <mutex>
+
+/**
+ * CLASS NAME: BlockCache
+ *
+ * DESCRIPTION: LRU cache of decoded SSTable blocks, bounded by bytes. A block is identified by
+ * 				its table id and block number; table ids are never reused, so blocks of deleted
+ * 				tables are never hit again and simply age out. Safe to share between threads.
+ */
+class BlockCache {
+private:
+	typedef pair<uint64_t, shared_ptr<const string> > Item;
+	size_t capacity;
+	size_t usage;
+	list<Item> lru;
+	unordered_map<uint64_t, list<Item>::iterator> items;
+	mutex lock;
+	unsigned long hits;
+	unsigned long misses;
+
+	static uint64_t cacheKey(uint64_t tableId, uint32_t block);
+public:
+	BlockCache(size_t capacity);
+	shared_ptr<const string> lookup(uint64_t tableId, uint32_t block);
+	void insert(uint64_t tableId, uint32_t block, const shared_ptr<const string> &contents);
+	void clear();
+	size_t getUsage();
+	unsigned long getHits();
+	unsigned long getMisses();
+	virtual ~BlockCache();
+};
+
+#endif /* BLOCKCACHE_H_ */
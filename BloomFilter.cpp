@@ -0,0 +1,131 @@
+/**********************************
+ * FILE NAME: BloomFilter.cpp
+ *
+ * DESCRIPTION: Definition of the BloomFilter class
+ **********************************/
+
+#include "BloomFilter.h"
+
+/**
+ * constructor
+ */
+BloomFilter::BloomFilter() {}
+
+/**
+ * Destructor
+ */
+BloomFilter::~BloomFilter() {}
+
+/**
+ * FUNCTION NAME: reset
+ *
+ * DESCRIPTION: Empty the filter and size it for expectedKeys keys
+ */
+void BloomFilter::reset(size_t expectedKeys, int bitsPerKey) {
+	// ln 2 probes per bit per key minimise false positives
+	int probes = (int)(bitsPerKey * 0.69);
+	probes = max(1, min(probes, BLOOM_MAX_PROBES));
+	size_t bits = max((size_t)64, expectedKeys * bitsPerKey);
+	data.assign((bits + 7) / 8 + 1, '\0');
+	data[data.size() - 1] = (char)probes;
+}
+
+/**
+ * FUNCTION NAME: hash
+ *
+ * DESCRIPTION: 64-bit FNV-1a, finished with the MurmurHash3 mixer so every bit depends on
+ * 				every key byte; both halves are used by the probes
+ */
+uint64_t BloomFilter::hash(const Slice &key) {
+	uint64_t h = 14695981039346656037ULL;
+	for ( size_t i = 0; i < key.size; i++ ) {
+		h ^= (unsigned char)key.data[i];
+		h *= 1099511628211ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+void BloomFilter::add(const Slice &key) {
+	addHash(hash(key));
+}
+
+/**
+ * FUNCTION NAME: addHash
+ *
+ * DESCRIPTION: Set the probe bits of a key hash. Probes are spaced by double hashing: the low
+ * 				half of the hash is the first bit, the high half the stride.
+ */
+void BloomFilter::addHash(uint64_t hash) {
+	if ( data.empty() ) {
+		return;
+	}
+	size_t bits = (data.size() - 1) * 8;
+	int probes = (unsigned char)data[data.size() - 1];
+	uint32_t position = (uint32_t)hash;
+	uint32_t stride = (uint32_t)(hash >> 32) | 1;
+	for ( int i = 0; i < probes; i++ ) {
+		size_t bit = position % bits;
+		data[bit / 8] |= (char)(1 << (bit % 8));
+		position += stride;
+	}
+}
+
+bool BloomFilter::mayContain(const Slice &key) const {
+	return mayContain(Slice(data), hash(key));
+}
+
+bool BloomFilter::mayContainHash(uint64_t hash) const {
+	return mayContain(Slice(data), hash);
+}
+
+/**
+ * FUNCTION NAME: mayContain
+ *
+ * DESCRIPTION: Query an encoded filter, e.g. one read from a file
+ *
+ * RETURNS:
+ * false if the key is definitely absent
+ * true if it may be present, or the filter is empty or malformed
+ */
+bool BloomFilter::mayContain(const Slice &encoded, uint64_t hash) {
+	if ( encoded.size < 2 ) {
+		return true;
+	}
+	size_t bits = (encoded.size - 1) * 8;
+	int probes = (unsigned char)encoded.data[encoded.size - 1];
+	if ( probes < 1 || probes > BLOOM_MAX_PROBES ) {
+		return true;
+	}
+	uint32_t position = (uint32_t)hash;
+	uint32_t stride = (uint32_t)(hash >> 32) | 1;
+	for ( int i = 0; i < probes; i++ ) {
+		size_t bit = position % bits;
+		if ( (encoded.data[bit / 8] & (1 << (bit % 8))) == 0 ) {
+			return false;
+		}
+		position += stride;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: load
+ *
+ * DESCRIPTION: Replace the filter with a copy of an encoded one
+ */
+void BloomFilter::load(const Slice &encoded) {
+	data.assign(encoded.data, encoded.size);
+}
+
+const string &BloomFilter::encoded() const {
+	return data;
+}
+
+size_t BloomFilter::memoryBytes() const {
+	return data.capacity();
+}
@@ -0,0 +1,47 @@
+/**********************************
+ * FILE NAME: BloomFilter.h
+ *
+ * DESCRIPTION: Header file of the BloomFilter class
+ **********************************/
+
+#ifndef BLOOMFILTER_H_
+#define BLOOMFILTER_H_
+
+#include "stdincludes.h"
+#include "Slice.h"
+
+/*
+ * Macros
+ */
+// about 1% false positives with the matching number of probes
+#define BLOOM_BITS_PER_KEY 10
+#define BLOOM_MAX_PROBES 30
+
+/**
+ * CLASS NAME: BloomFilter
+ *
+ * DESCRIPTION: Bloom filter over keys, answering "definitely absent" or "maybe present".
+ * 				The encoded form is the bit array followed by one byte holding the number of
+ * 				probes, so a filter stored in a file can be queried in place with the static
+ * 				mayContain(). An empty filter answers "maybe" for every key. Keys cannot be
+ * 				removed: owners rebuild the filter once enough of its keys are gone.
+ */
+class BloomFilter {
+private:
+	string data;
+public:
+	BloomFilter();
+	void reset(size_t expectedKeys, int bitsPerKey = BLOOM_BITS_PER_KEY);
+	void add(const Slice &key);
+	void addHash(uint64_t hash);
+	bool mayContain(const Slice &key) const;
+	bool mayContainHash(uint64_t hash) const;
+	void load(const Slice &encoded);
+	const string &encoded() const;
+	size_t memoryBytes() const;
+	static uint64_t hash(const Slice &key);
+	static bool mayContain(const Slice &encoded, uint64_t hash);
+	virtual ~BloomFilter();
+};
+
+#endif /* BLOOMFILTER_H_ */
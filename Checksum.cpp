@@ -0,0 +1,51 @@
+/**********************************
+ * FILE NAME: Checksum.cpp
+ *
+ * DESCRIPTION: Checksum definitions
+ **********************************/
+
+#include "Checksum.h"
+
+/**
+ * FUNCTION NAME: makeCrcTables
+ *
+ * DESCRIPTION: Lookup tables for slicing-by-8: tables[0] is the classic byte table, tables[k]
+ * 				advances a byte through k more zero bytes
+ */
+static const uint32_t (*makeCrcTables())[256] {
+	static uint32_t tables[8][256];
+	for ( uint32_t i = 0; i < 256; i++ ) {
+		uint32_t c = i;
+		for ( int k = 0; k < 8; k++ ) {
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+		tables[0][i] = c;
+	}
+	for ( uint32_t i = 0; i < 256; i++ ) {
+		for ( int k = 1; k < 8; k++ ) {
+			tables[k][i] = tables[0][tables[k - 1][i] & 0xFF] ^ (tables[k - 1][i] >> 8);
+		}
+	}
+	return tables;
+}
+
+/**
+ * FUNCTION NAME: crc32
+ *
+ * DESCRIPTION: Table-driven CRC-32, reflected, polynomial 0xEDB88320, eight bytes per step.
+ * 				Safe to call from several threads: the tables are built by the first caller.
+ */
+uint32_t crc32(const char *data, size_t size) {
+	static const uint32_t (*tables)[256] = makeCrcTables();
+	const unsigned char *p = (const unsigned char *)data;
+	uint32_t crc = 0xFFFFFFFFu;
+	for ( ; size >= 8; size -= 8, p += 8 ) {
+		uint32_t low = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+		crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF]
+				^ tables[4][low >> 24] ^ tables[3][p[4]] ^ tables[2][p[5]] ^ tables[1][p[6]] ^ tables[0][p[7]];
+	}
+	for ( ; size > 0; size--, p++ ) {
+		crc = tables[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFFu;
+}
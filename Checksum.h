@@ -0,0 +1,15 @@
+/**********************************
+ * FILE NAME: Checksum.h
+ *
+ * DESCRIPTION: Checksums for the on-disk formats (write-ahead log, snapshots)
+ **********************************/
+
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include "stdincludes.h"
+
+// CRC-32 (IEEE polynomial) of the bytes
+uint32_t crc32(const char *data, size_t size);
+
+#endif /* CHECKSUM_H_ */
@@ -0,0 +1,135 @@
+/**********************************
+ * FILE NAME: ClockEviction.cpp
+ *
+ * DESCRIPTION: Definition of the ClockEviction class
+ **********************************/
+
+#include "ClockEviction.h"
+
+/**
+ * constructor
+ */
+ClockEviction::ClockEviction(unsigned long budgetBytes): hand(0), budget(budgetBytes), charged(0), evictions(0) {}
+
+/**
+ * Destructor
+ */
+ClockEviction::~ClockEviction() {}
+
+/**
+ * FUNCTION NAME: charge
+ *
+ * DESCRIPTION: Track a key written with the given size. Rewriting a tracked key counts as an
+ * 				access to it.
+ */
+void ClockEviction::charge(const string &key, unsigned long bytes) {
+	bytes += key.size() + CLOCK_KEY_OVERHEAD;
+	auto search = positions.find(key);
+	if ( search != positions.end() ) {
+		Slot &slot = slots[search->second];
+		charged = charged - slot.bytes + bytes;
+		slot.bytes = bytes;
+		slot.referenced = true;
+		return;
+	}
+	size_t position;
+	if ( freeSlots.empty() ) {
+		position = slots.size();
+		slots.push_back(Slot());
+	}
+	else {
+		position = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	// unordered_map keys never move, so the slot can point at it
+	auto inserted = positions.emplace(key, position).first;
+	slots[position].key = &inserted->first;
+	slots[position].bytes = bytes;
+	slots[position].referenced = false;
+	charged += bytes;
+}
+
+void ClockEviction::touch(const string &key) {
+	auto search = positions.find(key);
+	if ( search != positions.end() ) {
+		slots[search->second].referenced = true;
+	}
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Stop tracking a key that was deleted or evicted
+ */
+void ClockEviction::remove(const string &key) {
+	auto search = positions.find(key);
+	if ( search == positions.end() ) {
+		return;
+	}
+	size_t position = search->second;
+	charged -= slots[position].bytes;
+	slots[position].key = NULL;
+	slots[position].bytes = 0;
+	freeSlots.push_back(position);
+	positions.erase(search);
+}
+
+bool ClockEviction::overBudget() const {
+	return charged > budget;
+}
+
+/**
+ * FUNCTION NAME: victim
+ *
+ * DESCRIPTION: Sweep the hand to the next tracked key with its reference bit clear, clearing the
+ * 				bits it passes. Two turns are enough: the first clears every bit.
+ *
+ * RETURNS:
+ * true and the key to evict
+ * false if no key is tracked
+ */
+bool ClockEviction::victim(string *key) {
+	if ( positions.empty() ) {
+		return false;
+	}
+	for ( size_t steps = 0; steps <= 2 * slots.size(); steps++ ) {
+		if ( hand >= slots.size() ) {
+			hand = 0;
+		}
+		Slot &slot = slots[hand++];
+		if ( slot.key == NULL ) {
+			continue;
+		}
+		if ( slot.referenced ) {
+			slot.referenced = false;
+			continue;
+		}
+		*key = *slot.key;
+		return true;
+	}
+	return false;
+}
+
+void ClockEviction::countEviction() {
+	evictions++;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Stop tracking every key; the eviction count is kept
+ */
+void ClockEviction::clear() {
+	vector<Slot>().swap(slots);
+	vector<size_t>().swap(freeSlots);
+	positions.clear();
+	hand = 0;
+	charged = 0;
+}
+
+void ClockEviction::getStats(EvictionStats *stats) const {
+	stats->budgetBytes = budget;
+	stats->chargedBytes = charged;
+	stats->keys = positions.size();
+	stats->evictions = evictions;
+}
@@ -0,0 +1,74 @@
+/**********************************
+ * FILE NAME: ClockEviction.h
+ *
+ * DESCRIPTION: Header file of the ClockEviction class
+ **********************************/
+
+#ifndef CLOCKEVICTION_H_
+#define CLOCKEVICTION_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// bytes of bookkeeping charged per tracked key on top of its copy: the hash map node and
+// bucket, and the slot
+#define CLOCK_KEY_OVERHEAD 96
+
+/**
+ * STRUCT NAME: EvictionStats
+ *
+ * DESCRIPTION: State of a memory budget; sizes are in bytes
+ */
+struct EvictionStats {
+	unsigned long budgetBytes;
+	// key and value bytes of the keys tracked, and what tracking them costs
+	unsigned long chargedBytes;
+	unsigned long keys;
+	unsigned long evictions;
+};
+
+/**
+ * CLASS NAME: ClockEviction
+ *
+ * DESCRIPTION: CLOCK (second chance) replacement over the keys of a table with a byte budget.
+ * 				Each key has a slot on a circular array holding its size and a reference bit
+ * 				that accesses set. To pick a victim the hand sweeps the array, clearing set bits,
+ * 				and stops at the first key whose bit is clear: keys used since the hand last
+ * 				passed survive, so the victim approximates the least recently used key at O(1)
+ * 				amortised cost and no list reordering on reads.
+ * 				New keys start unreferenced, so keys written once and never read go first.
+ * 				The copy of the key and the map entry that find its slot count against the
+ * 				budget like the key and value bytes do.
+ * 				The owner does the eviction and calls remove() for it like for any delete.
+ */
+class ClockEviction {
+private:
+	struct Slot {
+		// key in positions, NULL if the slot is free
+		const string *key;
+		unsigned long bytes;
+		bool referenced;
+	};
+	vector<Slot> slots;
+	vector<size_t> freeSlots;
+	unordered_map<string, size_t> positions;
+	size_t hand;
+	unsigned long budget;
+	unsigned long charged;
+	unsigned long evictions;
+public:
+	ClockEviction(unsigned long budgetBytes);
+	void charge(const string &key, unsigned long bytes);
+	void touch(const string &key);
+	void remove(const string &key);
+	bool overBudget() const;
+	bool victim(string *key);
+	void countEviction();
+	void clear();
+	void getStats(EvictionStats *stats) const;
+	virtual ~ClockEviction();
+};
+
+#endif /* CLOCKEVICTION_H_ */
@@ -8,11 +8,24 @@
 /**
  * constructor
  */
-Entry::Entry(string _value, int _timestamp, ReplicaType _replica){
+Entry::Entry(){
+	this->delimiter = ":";
+	timestamp = 0;
+	replica = PRIMARY;
+	expiresAt = 0;
+	deleted = false;
+}
+
+/**
+ * constructor
+ */
+Entry::Entry(string _value, int _timestamp, ReplicaType _replica, int _expiresAt){
 	this->delimiter = ":";
 	value = _value;
 	timestamp = _timestamp;
 	replica = _replica;
+	expiresAt = _expiresAt;
+	deleted = false;
 }
 
 /**
@@ -36,6 +49,8 @@ Entry::Entry(string entry){
 	value = tuple.at(0);
 	timestamp = stoi(tuple.at(1));
 	replica = static_cast<ReplicaType>(stoi(tuple.at(2)));
+	expiresAt = 0;
+	deleted = false;
 }
 
 /**
@@ -46,3 +61,114 @@ Entry::Entry(string entry){
 string Entry::convertToString() {
 	return value + delimiter + to_string(timestamp) + delimiter + to_string(replica);
 }
+
+/**
+ * FUNCTION NAME: isExpired
+ *
+ * DESCRIPTION: Whether the entry has expired by the given time
+ */
+bool Entry::isExpired(int time) const {
+	return expiresAt != 0 && expiresAt <= time;
+}
+
+/**
+ * FUNCTION NAME: encode
+ *
+ * DESCRIPTION: Pack the entry into the binary record kept in the HashTable. Entries that never
+ * 				expire leave the expiry time out.
+ */
+string Entry::encode() const {
+	size_t header = ENTRY_HEADER_SIZE + (expiresAt != 0 ? sizeof(int32_t) : 0);
+	string record(header + value.size(), '\0');
+	int32_t ts = timestamp;
+	memcpy(&record[ENTRY_TIMESTAMP_OFFSET], &ts, sizeof(int32_t));
+	record[ENTRY_REPLICA_OFFSET] = (char)replica;
+	if ( deleted ) {
+		record[ENTRY_REPLICA_OFFSET] |= (char)ENTRY_FLAG_DELETED;
+	}
+	if ( expiresAt != 0 ) {
+		int32_t expires = expiresAt;
+		record[ENTRY_REPLICA_OFFSET] |= (char)ENTRY_FLAG_EXPIRES;
+		memcpy(&record[ENTRY_EXPIRES_OFFSET], &expires, sizeof(int32_t));
+	}
+	memcpy(&record[header], value.data(), value.size());
+	return record;
+}
+
+/**
+ * FUNCTION NAME: decode
+ *
+ * DESCRIPTION: Fill this entry from a binary record
+ *
+ * RETURNS:
+ * false if the record is too short to be an entry
+ */
+bool Entry::decode(const Slice &record) {
+	if ( record.size < ENTRY_HEADER_SIZE
+			|| ((record.data[ENTRY_REPLICA_OFFSET] & ENTRY_FLAG_EXPIRES) != 0 && record.size < ENTRY_HEADER_SIZE + sizeof(int32_t)) ) {
+		return false;
+	}
+	timestamp = timestampOf(record);
+	replica = replicaOf(record);
+	expiresAt = expiresAtOf(record);
+	deleted = isDeleted(record);
+	Slice bytes = valueOf(record);
+	value.assign(bytes.data, bytes.size);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: replicaOf
+ *
+ * DESCRIPTION: Read the replica type straight out of a binary record
+ */
+ReplicaType Entry::replicaOf(const Slice &record) {
+	return static_cast<ReplicaType>((unsigned char)record.data[ENTRY_REPLICA_OFFSET] & ~(ENTRY_FLAG_EXPIRES | ENTRY_FLAG_DELETED));
+}
+
+/**
+ * FUNCTION NAME: isDeleted
+ *
+ * DESCRIPTION: Whether a binary record is a tombstone
+ */
+bool Entry::isDeleted(const Slice &record) {
+	return (record.data[ENTRY_REPLICA_OFFSET] & ENTRY_FLAG_DELETED) != 0;
+}
+
+/**
+ * FUNCTION NAME: timestampOf
+ *
+ * DESCRIPTION: Read the timestamp straight out of a binary record
+ */
+int Entry::timestampOf(const Slice &record) {
+	int32_t ts;
+	memcpy(&ts, record.data + ENTRY_TIMESTAMP_OFFSET, sizeof(int32_t));
+	return ts;
+}
+
+/**
+ * FUNCTION NAME: expiresAtOf
+ *
+ * DESCRIPTION: Read the expiry time straight out of a binary record, 0 if it never expires
+ */
+int Entry::expiresAtOf(const Slice &record) {
+	if ( (record.data[ENTRY_REPLICA_OFFSET] & ENTRY_FLAG_EXPIRES) == 0 ) {
+		return 0;
+	}
+	int32_t expires;
+	memcpy(&expires, record.data + ENTRY_EXPIRES_OFFSET, sizeof(int32_t));
+	return expires;
+}
+
+/**
+ * FUNCTION NAME: valueOf
+ *
+ * DESCRIPTION: The value bytes of a binary record, in place
+ */
+Slice Entry::valueOf(const Slice &record) {
+	size_t header = ENTRY_HEADER_SIZE;
+	if ( (record.data[ENTRY_REPLICA_OFFSET] & ENTRY_FLAG_EXPIRES) != 0 ) {
+		header += sizeof(int32_t);
+	}
+	return Slice(record.data + header, record.size - header);
+}
@@ -4,8 +4,25 @@
  * DESCRIPTION: Header file Entry class (Revised 2020)
  **********************************/
 
+#ifndef ENTRY_H_
+#define ENTRY_H_
+
 #include "stdincludes.h"
 #include "Message.h"
+#include "Slice.h"
+
+/*
+ * Macros
+ */
+// packed record layout: int32 timestamp | uint8 replica | [int32 expiry time] | value bytes
+// the expiry time is only there if the replica byte has ENTRY_FLAG_EXPIRES set
+#define ENTRY_TIMESTAMP_OFFSET 0
+#define ENTRY_REPLICA_OFFSET 4
+#define ENTRY_EXPIRES_OFFSET 5
+#define ENTRY_HEADER_SIZE 5
+#define ENTRY_FLAG_EXPIRES 0x80
+// set on the record of a delete sent between replicas; the hash table never stores one
+#define ENTRY_FLAG_DELETED 0x40
 
 /**
  * CLASS NAME: Entry
@@ -17,9 +34,26 @@ public:
 	string value;
 	int timestamp;
 	ReplicaType replica;
+	// time the entry expires at, 0 if it never does
+	int expiresAt;
+	// a tombstone: the key was deleted at timestamp
+	bool deleted;
 	string delimiter;
 
+	Entry();
 	Entry(string entry);
-	Entry(string _value, int _timestamp, ReplicaType _replica);
+	Entry(string _value, int _timestamp, ReplicaType _replica, int _expiresAt = 0);
 	string convertToString();
+	bool isExpired(int time) const;
+
+	// binary record stored in the HashTable
+	string encode() const;
+	bool decode(const Slice &record);
+	static ReplicaType replicaOf(const Slice &record);
+	static bool isDeleted(const Slice &record);
+	static int timestampOf(const Slice &record);
+	static int expiresAtOf(const Slice &record);
+	static Slice valueOf(const Slice &record);
 };
+
+#endif /* ENTRY_H_ */
@@ -0,0 +1,226 @@
+#!/bin/bash
+
+#################################################
+# FILE NAME: FeatureTester.sh
+#
+# DESCRIPTION: Runs the test cases that turn on the optional settings
+# 			   (see Optional settings in README.md) and checks what
+# 			   each run logged to dbg.log and stats.log
+#
+# RUN PROCEDURE:
+# $ chmod +x FeatureTester.sh
+# $ ./FeatureTester.sh
+#
+# Pass -v to see the output of make and of every run. The exit status is
+# the number of failed checks.
+#################################################
+
+
+function contains () {
+    local e
+    for e in "${@:2}"
+  	do
+    	if [ "$e" == "$1" ]; then
+      		echo 1
+      		return 1;
+    	fi
+  	done
+    echo 0
+}
+
+####
+# Helpers
+####
+
+# Run one test case
+function run () {
+    if [ "${verbose}" -eq 0 ]
+    then
+        ./Application ./testcases/$1 > /dev/null 2>&1
+    else
+        ./Application ./testcases/$1
+    fi
+}
+
+# Sum of every NAME=<number> field in stats.log
+function sumStat () {
+    grep -o "$1=[0-9]*" stats.log | cut -d= -f2 | awk '{ sum += $1 } END { print sum + 0 }'
+}
+
+# Number of dbg.log lines matching a pattern
+function countLog () {
+    grep -c "$1" dbg.log
+}
+
+# check <description> <actual> <test operator> <expected>
+function check () {
+    if [ "$2" $3 "$4" ]
+    then
+        echo "  PASS: $1"
+        PASSED=$((PASSED + 1))
+    else
+        echo "  FAIL: $1 (got $2, expected $3 $4)"
+        FAILED=$((FAILED + 1))
+    fi
+}
+
+# Outcome of the n-th coordinator line of an operation on the test key
+function outcome () {
+    grep "coordinator: $1" dbg.log | grep -v "${INVALID_KEY}" | sed -n "$2p" | grep -o "$1 [a-z]*"
+}
+
+####
+# Main function
+####
+
+verbose=$(contains "-v" "$@")
+
+###
+# Global variables
+###
+NODES=10
+CREATE_OPERATION="CREATE OPERATION"
+SERVER_CREATE_SUCCESS="server: create success"
+COORDINATOR_CREATE_SUCCESS="coordinator: create success"
+INVALID_KEY="invalidKey"
+PASSED=0
+FAILED=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+else
+    make clean
+    make
+fi
+if [ $? -ne 0 ]
+then
+    echo "COMPILATION ERROR !!!"
+    exit 1
+fi
+
+echo ""
+echo "############################"
+echo " WAL"
+echo "############################"
+rm -f wal-*.log snap-*.snap*
+run wal.conf
+KEYS=$(countLog "${CREATE_OPERATION}")
+check "every node writes a log" "$(ls wal-*.log 2> /dev/null | wc -l)" -eq "${NODES}"
+check "every key is stored on 3 replicas" "$(countLog "${SERVER_CREATE_SUCCESS}")" -eq "$((3 * KEYS))"
+run wal.conf
+check "the next run recovers every copy" "$(grep -o "[0-9]* keys recovered" dbg.log | awk '{ sum += $1 } END { print sum + 0 }')" -eq "$((3 * KEYS))"
+rm -f wal-*.log
+
+echo ""
+echo "############################"
+echo " SNAPSHOT_INTERVAL"
+echo "############################"
+run snapshot.conf
+KEYS=$(countLog "${CREATE_OPERATION}")
+check "every node writes a snapshot" "$(ls snap-*.snap 2> /dev/null | wc -l)" -eq "${NODES}"
+run snapshot.conf
+check "the next run maps every copy" "$(grep -o "mapped [0-9]* keys" dbg.log | awk '{ sum += $2 } END { print sum + 0 }')" -eq "$((3 * KEYS))"
+rm -f wal-*.log snap-*.snap*
+
+echo ""
+echo "############################"
+echo " STORAGE_ENGINE: LSM"
+echo "############################"
+run lsm.conf
+KEYS=$(countLog "${CREATE_OPERATION}")
+check "every key is stored on 3 replicas" "$(countLog "${SERVER_CREATE_SUCCESS}")" -eq "$((3 * KEYS))"
+check "the nodes count every copy" "$(sumStat "storage: keys")" -eq "$((3 * KEYS))"
+check "the table files are removed on exit" "$(ls -d lsm-* 2> /dev/null | wc -l)" -eq 0
+
+echo ""
+echo "############################"
+echo " KEY_TTL"
+echo "############################"
+run ttl.conf
+KEYS=$(countLog "${CREATE_OPERATION}")
+check "every create succeeds" "$(countLog "${COORDINATOR_CREATE_SUCCESS}")" -eq "${KEYS}"
+check "the nodes report expired keys" "$(countLog "TTL: ")" -gt 0
+check "no key outlives its time to live" "$(sumStat "storage: keys")" -eq 0
+
+echo ""
+echo "############################"
+echo " VNODES"
+echo "############################"
+run vnodes.conf
+KEYS=$(countLog "${CREATE_OPERATION}")
+check "every node places 8 points" "$(grep -c "load: vnodes=8 " stats.log)" -eq "${NODES}"
+check "every key has one primary" "$(sumStat primaryKeys)" -eq "${KEYS}"
+check "every key is stored on 3 replicas" "$(sumStat "storage: keys")" -eq "$((3 * KEYS))"
+
+echo ""
+echo "############################"
+echo " MEMORY_BUDGET"
+echo "############################"
+run memorybudget.conf
+check "the nodes evict keys" "$(countLog "cache: evicted")" -gt 0
+check "no node ends over its budget" "$(grep -o "budget=[0-9]* used=[0-9]*" stats.log | tr '=' ' ' | awk '$4 > $2' | wc -l)" -eq 0
+
+echo ""
+echo "############################"
+echo " REPLICATION_FACTOR"
+echo "############################"
+run replication.conf
+KEYS=$(countLog "${CREATE_OPERATION}")
+check "every key is stored on 5 replicas" "$(countLog "${SERVER_CREATE_SUCCESS}")" -eq "$((5 * KEYS))"
+check "the nodes count every copy" "$(sumStat "storage: keys")" -eq "$((5 * KEYS))"
+
+echo ""
+echo "############################"
+echo " READ_QUORUM / WRITE_QUORUM"
+echo "############################"
+run quorum.conf
+check "an update with every replica up succeeds" "$(outcome update 1)" == "update success"
+check "an update with one replica down fails" "$(outcome update 2)" == "update fail"
+
+echo ""
+echo "############################"
+echo " HEDGE_DELAY"
+echo "############################"
+run hedge.conf
+check "a read with every replica up succeeds" "$(outcome read 1)" == "read success"
+check "a read with one replica down succeeds" "$(outcome read 2)" == "read success"
+check "the coordinators hedge reads" "$(sumStat hedgesFired)" -gt 0
+
+echo ""
+echo "############################"
+echo " SLOPPY_QUORUM"
+echo "############################"
+rm -f hints-*.log
+run sloppyquorum.conf
+check "an update with every replica up succeeds" "$(outcome update 1)" == "update success"
+check "an update with one replica down succeeds" "$(outcome update 2)" == "update success"
+check "every node reports its hints" "$(grep -c "hints: " stats.log)" -eq "${NODES}"
+check "every node keeps a hint file" "$(ls hints-*.log 2> /dev/null | wc -l)" -eq "${NODES}"
+check "every hint is handed over or held" "$(( $(sumStat stored) + $(sumStat recovered) ))" -eq "$(( $(sumStat replayed) + $(sumStat held) ))"
+rm -f hints-*.log
+
+echo ""
+echo "############################"
+echo " REBALANCING"
+echo "############################"
+run rebalance.conf
+STREAMS=$(sumStat streams)
+check "the nodes stream keys to new replicas" "${STREAMS}" -gt 0
+check "every stream ends or is still open" "${STREAMS}" -eq "$(( $(sumStat completed) + $(sumStat abandoned) + $(sumStat open) ))"
+check "the new replicas take the keys in" "$(sumStat received)" -gt 0
+check "anti-entropy is off by default" "$(grep -c "antiEntropy: " stats.log)" -eq 0
+
+echo ""
+echo "############################"
+echo " ANTI_ENTROPY_INTERVAL"
+echo "############################"
+run antientropy.conf
+check "every node reports anti-entropy" "$(grep -c "antiEntropy: " stats.log)" -eq "${NODES}"
+check "the primaries start rounds" "$(sumStat rounds)" -gt 0
+check "the replicas exchange digests" "$(sumStat digests)" -gt 0
+
+echo ""
+echo "CHECKS PASSED: ${PASSED}, FAILED: ${FAILED}"
+exit ${FAILED}
@@ -0,0 +1,414 @@
+/**********************************
+ * FILE NAME: FlatHashEngine.cpp
+ *
+ * DESCRIPTION: Open-addressing (Robin Hood) storage engine definition
+ **********************************/
+
+#include "FlatHashEngine.h"
+
+/**
+ * constructor
+ */
+FlatHashEngine::FlatHashEngine() {
+	clear();
+}
+
+/**
+ * Destructor
+ */
+FlatHashEngine::~FlatHashEngine() {}
+
+/**
+ * FUNCTION NAME: hashKey
+ *
+ * DESCRIPTION: 32-bit hash of the key stored in the slot: FNV-1a over the bytes, then the
+ * 				murmur3 finalizer so the low bits used for the home slot are well mixed
+ */
+uint32_t FlatHashEngine::hashKey(const Slice &key) {
+	uint32_t h = 2166136261u;
+	for ( size_t i = 0; i < key.size; i++ ) {
+		h = (h ^ (unsigned char)key.data[i]) * 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+/**
+ * FUNCTION NAME: probeDistance
+ *
+ * DESCRIPTION: How far the slot at index is from the home slot of hash
+ */
+uint32_t FlatHashEngine::probeDistance(uint32_t hash, uint32_t index) const {
+	return (index - (hash & mask)) & mask;
+}
+
+/**
+ * FUNCTION NAME: keyOf
+ *
+ * DESCRIPTION: The key bytes of a live record, in its arena block
+ */
+Slice FlatHashEngine::keyOf(const Record &record) const {
+	return Slice(arena.at(record.block), record.keySize);
+}
+
+/**
+ * FUNCTION NAME: valueOf
+ *
+ * DESCRIPTION: The value bytes of a live record, right after its key
+ */
+Slice FlatHashEngine::valueOf(const Record &record) const {
+	return Slice(arena.at(record.block) + record.keySize, record.valueSize);
+}
+
+/**
+ * FUNCTION NAME: findSlot
+ *
+ * DESCRIPTION: Probe for the key. Robin Hood ordering lets the probe stop as soon as it meets
+ * 				a slot closer to its home than we are to ours.
+ *
+ * RETURNS:
+ * slot index if found
+ * -1 otherwise
+ */
+long FlatHashEngine::findSlot(const Slice &key, uint32_t hash) const {
+	uint32_t index = hash & mask;
+	for ( uint32_t distance = 0; ; distance++ ) {
+		const Slot &slot = slots[index];
+		if ( slot.record == 0 || probeDistance(slot.hash, index) < distance ) {
+			return -1;
+		}
+		if ( slot.hash == hash && keyOf(records[slot.record - 1]) == key ) {
+			return (long)index;
+		}
+		index = (index + 1) & mask;
+	}
+}
+
+/**
+ * FUNCTION NAME: allocRecord
+ *
+ * DESCRIPTION: Copy the pair into a new arena block, point a free record at it and return
+ * 				the record index
+ */
+uint32_t FlatHashEngine::allocRecord(const Slice &key, const Slice &value, unsigned char tag) {
+	uint32_t index;
+	if ( !freeRecords.empty() ) {
+		index = freeRecords.back();
+		freeRecords.pop_back();
+	}
+	else {
+		index = (uint32_t)records.size();
+		records.emplace_back();
+	}
+	Record &record = records[index];
+	record.block = arena.allocate((uint32_t)(key.size + value.size));
+	record.keySize = (uint32_t)key.size;
+	record.valueSize = (uint32_t)value.size;
+	char *bytes = arena.at(record.block);
+	memcpy(bytes, key.data, key.size);
+	memcpy(bytes + key.size, value.data, value.size);
+	record.live = true;
+	payloadBytes += key.size + value.size;
+	linkTag(index, tag);
+	return index;
+}
+
+/**
+ * FUNCTION NAME: linkTag
+ *
+ * DESCRIPTION: Push the record onto the front of the list for tag
+ */
+void FlatHashEngine::linkTag(uint32_t index, unsigned char tag) {
+	Record &record = records[index];
+	record.tag = tag;
+	record.prev = 0;
+	record.next = tagHeads[tag];
+	if ( record.next != 0 ) {
+		records[record.next - 1].prev = index + 1;
+	}
+	tagHeads[tag] = index + 1;
+	tagCounts[tag]++;
+}
+
+/**
+ * FUNCTION NAME: unlinkTag
+ *
+ * DESCRIPTION: Take the record off its tag list
+ */
+void FlatHashEngine::unlinkTag(uint32_t index) {
+	Record &record = records[index];
+	if ( record.prev != 0 ) {
+		records[record.prev - 1].next = record.next;
+	}
+	else {
+		tagHeads[record.tag] = record.next;
+	}
+	if ( record.next != 0 ) {
+		records[record.next - 1].prev = record.prev;
+	}
+	tagCounts[record.tag]--;
+}
+
+/**
+ * FUNCTION NAME: placeSlot
+ *
+ * DESCRIPTION: Robin Hood insertion starting at index: take the slot from any entry that is
+ * 				closer to its home, then carry the displaced entry forward
+ */
+void FlatHashEngine::placeSlot(Slot slot, uint32_t index, uint32_t distance) {
+	while ( true ) {
+		Slot &current = slots[index];
+		if ( current.record == 0 ) {
+			current = slot;
+			return;
+		}
+		uint32_t currentDistance = probeDistance(current.hash, index);
+		if ( currentDistance < distance ) {
+			swap(current, slot);
+			distance = currentDistance;
+		}
+		index = (index + 1) & mask;
+		distance++;
+	}
+}
+
+/**
+ * FUNCTION NAME: grow
+ *
+ * DESCRIPTION: Double the probe array and re-place every slot. Records are not touched.
+ */
+void FlatHashEngine::grow() {
+	vector<Slot> old;
+	old.swap(slots);
+	slots.assign(old.size() * 2, Slot());
+	mask = (uint32_t)slots.size() - 1;
+	for ( size_t i = 0; i < old.size(); i++ ) {
+		if ( old[i].record != 0 ) {
+			placeSlot(old[i], old[i].hash & mask, 0);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Single probe: the walk that rules the key out also finds its insertion point
+ */
+bool FlatHashEngine::insert(const Slice &key, const Slice &value, unsigned char tag) {
+	if ( (count + 1) * FLAT_MAX_LOAD_DEN > slots.size() * FLAT_MAX_LOAD_NUM ) {
+		grow();
+	}
+	uint32_t hash = hashKey(key);
+	uint32_t index = hash & mask;
+	uint32_t distance = 0;
+	while ( true ) {
+		const Slot &slot = slots[index];
+		if ( slot.record == 0 || probeDistance(slot.hash, index) < distance ) {
+			break;
+		}
+		if ( slot.hash == hash && keyOf(records[slot.record - 1]) == key ) {
+			// Key already exists
+			return false;
+		}
+		index = (index + 1) & mask;
+		distance++;
+	}
+	Slot fresh;
+	fresh.hash = hash;
+	fresh.record = allocRecord(key, value, tag) + 1;
+	placeSlot(fresh, index, distance);
+	count++;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: lookup
+ *
+ * DESCRIPTION: Point value at the stored value of the key, in place in the arena
+ *
+ * RETURNS:
+ * false if the key is absent
+ */
+bool FlatHashEngine::lookup(const Slice &key, Slice *value) {
+	long index = findSlot(key, hashKey(key));
+	if ( index < 0 ) {
+		return false;
+	}
+	*value = valueOf(records[slots[index].record - 1]);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: assign
+ *
+ * DESCRIPTION: Overwrite the value of an existing key, in place if the new pair still fits the
+ * 				arena block, and move the record to another tag list if the tag changed
+ */
+bool FlatHashEngine::assign(const Slice &key, const Slice &value, unsigned char tag, string *previous) {
+	long index = findSlot(key, hashKey(key));
+	if ( index < 0 ) {
+		return false;
+	}
+	uint32_t recordIndex = slots[index].record - 1;
+	Record &record = records[recordIndex];
+	if ( previous != NULL ) {
+		Slice old = valueOf(record);
+		previous->assign(old.data, old.size);
+	}
+	uint32_t oldSize = record.keySize + record.valueSize;
+	uint32_t newSize = record.keySize + (uint32_t)value.size;
+	if ( arena.blockSize(newSize) == arena.blockSize(oldSize) ) {
+		// value may point into this very block
+		memmove(arena.at(record.block) + record.keySize, value.data, value.size);
+	}
+	else {
+		ArenaRef block = arena.allocate(newSize);
+		char *bytes = arena.at(block);
+		memcpy(bytes, arena.at(record.block), record.keySize);
+		memcpy(bytes + record.keySize, value.data, value.size);
+		arena.release(record.block);
+		record.block = block;
+	}
+	payloadBytes = payloadBytes - record.valueSize + value.size;
+	record.valueSize = (uint32_t)value.size;
+	if ( record.tag != tag ) {
+		unlinkTag(recordIndex);
+		linkTag(recordIndex, tag);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Remove the key and close the gap by shifting the following run back one slot
+ * 				(backward-shift deletion, so no tombstones are left in the probe array)
+ */
+bool FlatHashEngine::erase(const Slice &key, string *previous) {
+	long found = findSlot(key, hashKey(key));
+	if ( found < 0 ) {
+		return false;
+	}
+	uint32_t index = (uint32_t)found;
+	uint32_t recordIndex = slots[index].record - 1;
+	Record &record = records[recordIndex];
+	if ( previous != NULL ) {
+		Slice old = valueOf(record);
+		previous->assign(old.data, old.size);
+	}
+	unlinkTag(recordIndex);
+	arena.release(record.block);
+	payloadBytes -= record.keySize + record.valueSize;
+	record.live = false;
+	freeRecords.push_back(recordIndex);
+
+	while ( true ) {
+		uint32_t next = (index + 1) & mask;
+		if ( slots[next].record == 0 || probeDistance(slots[next].hash, next) == 0 ) {
+			break;
+		}
+		slots[index] = slots[next];
+		index = next;
+	}
+	slots[index].record = 0;
+	count--;
+	return true;
+}
+
+unsigned long FlatHashEngine::size() {
+	return count;
+}
+
+void FlatHashEngine::clear() {
+	slots.assign(FLAT_MIN_CAPACITY, Slot());
+	mask = FLAT_MIN_CAPACITY - 1;
+	records.clear();
+	freeRecords.clear();
+	arena.clear();
+	payloadBytes = 0;
+	count = 0;
+	memset(tagHeads, 0, sizeof(tagHeads));
+	memset(tagCounts, 0, sizeof(tagCounts));
+}
+
+/**
+ * FUNCTION NAME: scan
+ *
+ * DESCRIPTION: Visit every pair by walking the dense record array
+ */
+void FlatHashEngine::scan(const function<void(const Slice &, const Slice &)> &visit) {
+	for ( size_t i = 0; i < records.size(); i++ ) {
+		if ( records[i].live ) {
+			visit(keyOf(records[i]), valueOf(records[i]));
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: scanTag
+ *
+ * DESCRIPTION: Walk the intrusive list of the tag, stopping early if visit returns false
+ */
+void FlatHashEngine::scanTag(unsigned char tag, const function<bool(const Slice &, const Slice &)> &visit) {
+	uint32_t id = tagHeads[tag];
+	while ( id != 0 ) {
+		const Record &record = records[id - 1];
+		if ( !visit(keyOf(record), valueOf(record)) ) {
+			return;
+		}
+		id = record.next;
+	}
+}
+
+unsigned long FlatHashEngine::countTag(unsigned char tag) {
+	return tagCounts[tag];
+}
+
+/**
+ * FUNCTION NAME: getStats
+ *
+ * DESCRIPTION: Exact footprint: arena usage plus the probe and record arrays
+ */
+void FlatHashEngine::getStats(StorageStats *stats) {
+	stats->keys = count;
+	stats->payloadBytes = payloadBytes;
+	stats->allocatedBytes = arena.getAllocatedBytes();
+	stats->reservedBytes = arena.getReservedBytes();
+	stats->indexBytes = slots.capacity() * sizeof(Slot) + records.capacity() * sizeof(Record)
+			+ freeRecords.capacity() * sizeof(uint32_t);
+	stats->slabs = arena.getSlabCount();
+	stats->mappedBytes = 0;
+	stats->diskBytes = 0;
+	stats->filterNegatives = 0;
+	stats->filterFalsePositives = 0;
+}
+
+/**
+ * FUNCTION NAME: compact
+ *
+ * DESCRIPTION: If the arena is fragmented enough, move every record out of its sparse slabs
+ * 				so they can be given back. Slots only hold record indexes, so just the records
+ * 				being moved are touched.
+ */
+bool FlatHashEngine::compact() {
+	if ( !arena.needsCompaction() ) {
+		return false;
+	}
+	arena.beginCompaction();
+	for ( size_t i = 0; i < records.size(); i++ ) {
+		Record &record = records[i];
+		if ( record.live && arena.isEvacuating(record.block) ) {
+			uint32_t blockBytes = record.keySize + record.valueSize;
+			ArenaRef block = arena.allocate(blockBytes);
+			memcpy(arena.at(block), arena.at(record.block), blockBytes);
+			arena.release(record.block);
+			record.block = block;
+		}
+	}
+	arena.endCompaction();
+	return true;
+}
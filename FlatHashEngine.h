@@ -0,0 +1,92 @@
+/**********************************
+ * FILE NAME: FlatHashEngine.h
+ *
+ * DESCRIPTION: Header file of the open-addressing (Robin Hood) storage engine
+ **********************************/
+
+#ifndef FLATHASHENGINE_H_
+#define FLATHASHENGINE_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include "StorageEngine.h"
+#include "SlabArena.h"
+
+/*
+ * Macros
+ */
+#define FLAT_MIN_CAPACITY 16
+// grow when size exceeds 7/8 of the slots
+#define FLAT_MAX_LOAD_NUM 7
+#define FLAT_MAX_LOAD_DEN 8
+
+/**
+ * CLASS NAME: FlatHashEngine
+ *
+ * DESCRIPTION: Open-addressing hash table using Robin Hood linear probing.
+ * 				The probe array holds only 8-byte slots (32-bit hash, record index), so a lookup
+ * 				walks one contiguous run of memory and compares hashes before touching a key.
+ * 				Records live in a separate array whose indexes never change while the record is
+ * 				live, so growing or shifting the probe array moves no bytes. The key and value
+ * 				bytes of a record share one block of a SlabArena.
+ * 				Records with the same tag are threaded on an intrusive doubly linked list, so
+ * 				scanTag() touches only the matching records.
+ */
+class FlatHashEngine : public StorageEngine {
+private:
+	struct Slot {
+		uint32_t hash;
+		// index into records plus one, 0 marks an empty slot
+		uint32_t record;
+	};
+	struct Record {
+		// key bytes followed by value bytes
+		ArenaRef block;
+		uint32_t keySize;
+		uint32_t valueSize;
+		// neighbours on the tag list, as record index plus one (0 ends the list)
+		uint32_t prev;
+		uint32_t next;
+		unsigned char tag;
+		bool live;
+	};
+	vector<Slot> slots;
+	vector<Record> records;
+	vector<uint32_t> freeRecords;
+	SlabArena arena;
+	unsigned long payloadBytes;
+	uint32_t mask;
+	unsigned long count;
+	// first record of each tag list, as record index plus one
+	uint32_t tagHeads[256];
+	unsigned long tagCounts[256];
+
+	static uint32_t hashKey(const Slice &key);
+	uint32_t probeDistance(uint32_t hash, uint32_t index) const;
+	Slice keyOf(const Record &record) const;
+	Slice valueOf(const Record &record) const;
+	long findSlot(const Slice &key, uint32_t hash) const;
+	uint32_t allocRecord(const Slice &key, const Slice &value, unsigned char tag);
+	void linkTag(uint32_t index, unsigned char tag);
+	void unlinkTag(uint32_t index);
+	void placeSlot(Slot slot, uint32_t index, uint32_t distance);
+	void grow();
+public:
+	FlatHashEngine();
+	bool insert(const Slice &key, const Slice &value, unsigned char tag);
+	bool lookup(const Slice &key, Slice *value);
+	bool assign(const Slice &key, const Slice &value, unsigned char tag, string *previous = NULL);
+	bool erase(const Slice &key, string *previous = NULL);
+	unsigned long size();
+	void clear();
+	void scan(const function<void(const Slice &, const Slice &)> &visit);
+	void scanTag(unsigned char tag, const function<bool(const Slice &, const Slice &)> &visit);
+	unsigned long countTag(unsigned char tag);
+	void getStats(StorageStats *stats);
+	bool compact();
+	virtual ~FlatHashEngine();
+};
+
+#endif /* FLATHASHENGINE_H_ */
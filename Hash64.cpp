@@ -0,0 +1,175 @@
+/**********************************
+ * FILE NAME: Hash64.cpp
+ *
+ * DESCRIPTION: Definition of the XXH64 hash
+ **********************************/
+
+#include "Hash64.h"
+
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+// little-endian loads, whatever the host byte order
+static inline uint64_t read64(const unsigned char *p) {
+	uint64_t v = 0;
+	for ( int i = 7; i >= 0; i-- ) {
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+static inline uint32_t read32(const unsigned char *p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc, uint64_t value) {
+	acc ^= round64(0, value);
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+/**
+ * FUNCTION NAME: xxh64Start
+ *
+ * DESCRIPTION: XXH64 up to the words after the last 32-byte stripe: the four stripe lanes
+ * 				merged for a key of 32 bytes or more, the seed for a shorter one, plus the size
+ *
+ * RETURNS:
+ * the accumulator, with p moved past the stripes
+ */
+static inline uint64_t xxh64Start(const unsigned char *&p, size_t size, uint64_t seed) {
+	uint64_t h;
+
+	if ( size >= 32 ) {
+		const unsigned char *limit = p + size - 32;
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+		do {
+			v1 = round64(v1, read64(p));
+			v2 = round64(v2, read64(p + 8));
+			v3 = round64(v3, read64(p + 16));
+			v4 = round64(v4, read64(p + 24));
+			p += 32;
+		} while ( p <= limit );
+		h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+		h = mergeRound(h, v1);
+		h = mergeRound(h, v2);
+		h = mergeRound(h, v3);
+		h = mergeRound(h, v4);
+	}
+	else {
+		h = seed + PRIME64_5;
+	}
+	return h + (uint64_t)size;
+}
+
+/**
+ * FUNCTION NAME: xxh64Finish
+ *
+ * DESCRIPTION: XXH64 from the accumulator on: the remaining 8-, 4- and 1-byte pieces up to
+ * 				end, then the avalanche
+ */
+static inline uint64_t xxh64Finish(uint64_t h, const unsigned char *p, const unsigned char *end) {
+	while ( p + 8 <= end ) {
+		h ^= round64(0, read64(p));
+		h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+		p += 8;
+	}
+	if ( p + 4 <= end ) {
+		h ^= (uint64_t)read32(p) * PRIME64_1;
+		h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	while ( p < end ) {
+		h ^= (*p) * PRIME64_5;
+		h = rotl64(h, 11) * PRIME64_1;
+		p++;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+/**
+ * FUNCTION NAME: xxh64
+ *
+ * DESCRIPTION: XXH64 as specified by its reference implementation: four lanes over 32-byte
+ * 				stripes, then the remaining 8-, 4- and 1-byte pieces, then the avalanche
+ */
+static inline uint64_t xxh64(const unsigned char *p, size_t size, uint64_t seed) {
+	const unsigned char *end = p + size;
+	uint64_t h = xxh64Start(p, size, seed);
+	return xxh64Finish(h, p, end);
+}
+
+uint64_t hash64(const char *data, size_t size, uint64_t seed) {
+	return xxh64((const unsigned char *)data, size, seed);
+}
+
+/**
+ * FUNCTION NAME: hash64Batch
+ *
+ * DESCRIPTION: Hash keys four at a time. The 8-byte rounds that all four keys have are
+ * 				interleaved by hand, one round of each key in turn, so the four multiply chains
+ * 				are independent instructions a compiler may overlap. The short keys the ring
+ * 				sees spend nearly all their time in those rounds. The 32-byte stripes of longer
+ * 				keys already run four independent lanes and are done key by key, as are the
+ * 				leftover pieces and the avalanche.
+ */
+void hash64Batch(const Slice *keys, size_t count, uint64_t *hashes, uint64_t seed) {
+	size_t i = 0;
+	for ( ; i + 4 <= count; i += 4 ) {
+		const unsigned char *p0 = (const unsigned char *)keys[i].data;
+		const unsigned char *p1 = (const unsigned char *)keys[i + 1].data;
+		const unsigned char *p2 = (const unsigned char *)keys[i + 2].data;
+		const unsigned char *p3 = (const unsigned char *)keys[i + 3].data;
+		const unsigned char *end0 = p0 + keys[i].size;
+		const unsigned char *end1 = p1 + keys[i + 1].size;
+		const unsigned char *end2 = p2 + keys[i + 2].size;
+		const unsigned char *end3 = p3 + keys[i + 3].size;
+		uint64_t h0 = xxh64Start(p0, keys[i].size, seed);
+		uint64_t h1 = xxh64Start(p1, keys[i + 1].size, seed);
+		uint64_t h2 = xxh64Start(p2, keys[i + 2].size, seed);
+		uint64_t h3 = xxh64Start(p3, keys[i + 3].size, seed);
+		size_t words = min(min(end0 - p0, end1 - p1), min(end2 - p2, end3 - p3)) / 8;
+		for ( ; words > 0; words-- ) {
+			h0 ^= round64(0, read64(p0));
+			h1 ^= round64(0, read64(p1));
+			h2 ^= round64(0, read64(p2));
+			h3 ^= round64(0, read64(p3));
+			h0 = rotl64(h0, 27) * PRIME64_1 + PRIME64_4;
+			h1 = rotl64(h1, 27) * PRIME64_1 + PRIME64_4;
+			h2 = rotl64(h2, 27) * PRIME64_1 + PRIME64_4;
+			h3 = rotl64(h3, 27) * PRIME64_1 + PRIME64_4;
+			p0 += 8;
+			p1 += 8;
+			p2 += 8;
+			p3 += 8;
+		}
+		hashes[i] = xxh64Finish(h0, p0, end0);
+		hashes[i + 1] = xxh64Finish(h1, p1, end1);
+		hashes[i + 2] = xxh64Finish(h2, p2, end2);
+		hashes[i + 3] = xxh64Finish(h3, p3, end3);
+	}
+	for ( ; i < count; i++ ) {
+		hashes[i] = xxh64((const unsigned char *)keys[i].data, keys[i].size, seed);
+	}
+}
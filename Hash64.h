@@ -0,0 +1,24 @@
+/**********************************
+ * FILE NAME: Hash64.h
+ *
+ * DESCRIPTION: Stable 64-bit hash placing keys and nodes on the ring
+ **********************************/
+
+#ifndef HASH64_H_
+#define HASH64_H_
+
+#include "stdincludes.h"
+#include "Slice.h"
+
+/*
+ * XXH64 (xxHash, 64-bit variant) of the bytes with the given seed. The algorithm is fixed and
+ * written out in Hash64.cpp, so a key lands on the same ring position with any compiler,
+ * standard library or platform: XXH64("", 0) = 0xEF46DB3751D8E999 and
+ * XXH64("abc", 0) = 0x44BC2CF5AD770999 pin it down.
+ */
+uint64_t hash64(const char *data, size_t size, uint64_t seed = 0);
+
+// hashes[i] = hash64(keys[i], seed) for count keys, four at a time with their rounds interleaved
+void hash64Batch(const Slice *keys, size_t count, uint64_t *hashes, uint64_t seed = 0);
+
+#endif /* HASH64_H_ */
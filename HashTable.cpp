@@ -5,10 +5,37 @@
  **********************************/
 
 #include "HashTable.h"
+#include "MapEngine.h"
+#include "FlatHashEngine.h"
+#include "LSMEngine.h"
+#include <deque>
 
-HashTable::HashTable() {}
+HashTable::HashTable(StorageEngineType engineType, const string &directory) {
+	switch ( engineType ) {
+		case MAP_ENGINE:
+			engine = new MapEngine();
+			break;
+		case LSM_ENGINE:
+			engine = new LSMEngine(directory);
+			break;
+		case FLAT_HASH_ENGINE:
+		default:
+			engine = new FlatHashEngine();
+			break;
+	}
+	base = NULL;
+	clock = NULL;
+	dropBase();
+	filterNegatives = 0;
+	filterFalsePositives = 0;
+	rebuildFilter();
+}
 
-HashTable::~HashTable() {}
+HashTable::~HashTable() {
+	delete clock;
+	delete base;
+	delete engine;
+}
 
 /**
  * FUNCTION NAME: create
@@ -19,32 +46,42 @@ HashTable::~HashTable() {}
  * true on SUCCESS
  * false in FAILURE
  */
-bool HashTable::create(string key, string value) {
-	hashTable.emplace(key, value);
+bool HashTable::create(const string &key, const Entry &entry) {
+	if ( findInBase(key) >= 0 ) {
+		// Key already exists in the snapshot
+		return true;
+	}
+	string record = entry.encode();
+	if ( engine->insert(key, record, (unsigned char)entry.replica) ) {
+		addToFilter(key);
+		charge(key, record);
+		merkle.insert(key, entry.value);
+	}
 	return true;
 }
 
 /**
  * FUNCTION NAME: read
  *
- * DESCRIPTION: This function searches for the key in the hash table
+ * DESCRIPTION: This function searches for the key in the hash table and decodes its entry
  *
  * RETURNS:
- * string value if found
- * else it returns a NULL
+ * true and the entry if found
+ * false otherwise
  */
-string HashTable::read(string key) {
-	map<string, string>::iterator search;
+bool HashTable::read(const string &key, Entry *entry) {
+	Slice record;
 
-	search = hashTable.find(key);
-	if ( search != hashTable.end() ) {
-		// Value found
-		return search->second;
-	}
-	else {
-		// Value not found
-		return "";
+	if ( !lookupInEngine(key, &record) ) {
+		long position = findInBase(key);
+		if ( position < 0 ) {
+			// Value not found
+			return false;
+		}
+		record = base->valueAt(position);
 	}
+	// Value found
+	return entry->decode(record);
 }
 
 /**
@@ -57,17 +94,33 @@ string HashTable::read(string key) {
  * true on SUCCESS
  * false on FAILURE
  */
-bool HashTable::update(string key, string newValue) {
-	map<string, string>::iterator update;
-
-	if (read(key).empty()) {
-		// Key not found
+bool HashTable::update(const string &key, const Entry &entry) {
+	// A single probe finds and overwrites the key
+	string record = entry.encode();
+	if ( mayBeInEngine(key) ) {
+		// the Merkle trees need the pair being replaced; the same probe hands it over
+		string previous;
+		if ( engine->assign(key, record, (unsigned char)entry.replica, merkle.active() ? &previous : NULL) ) {
+			charge(key, record);
+			if ( merkle.active() ) {
+				merkle.erase(key, Entry::valueOf(previous));
+			}
+			merkle.insert(key, entry.value);
+			return true;
+		}
+		filterFalsePositives++;
+	}
+	long position = findInBase(key);
+	if ( position < 0 ) {
 		return false;
 	}
-	// Key found
-	//update = hashTable.at(key) = newValue;
-	hashTable.at(key) = newValue;
-	// Update successful
+	// The new value hides the snapshot copy
+	merkle.erase(key, Entry::valueOf(base->valueAt(position)));
+	shadow(position);
+	engine->insert(key, record, (unsigned char)entry.replica);
+	addToFilter(key);
+	charge(key, record);
+	merkle.insert(key, entry.value);
 	return true;
 }
 
@@ -80,19 +133,27 @@ bool HashTable::update(string key, string newValue) {
  * true on SUCCESS
  * false on FAILURE
  */
-bool HashTable::deleteKey(string key) {
-	uint eraseCount = 0;
-
-	if (read(key).empty()) {
-		// Key not found
-		return false;
+bool HashTable::deleteKey(const string &key) {
+	// A single probe finds and erases the key
+	if ( mayBeInEngine(key) ) {
+		string previous;
+		if ( engine->erase(key, merkle.active() ? &previous : NULL) ) {
+			if ( merkle.active() ) {
+				merkle.erase(key, Entry::valueOf(previous));
+			}
+			if ( clock != NULL ) {
+				clock->remove(key);
+			}
+			return true;
+		}
+		filterFalsePositives++;
 	}
-	eraseCount = hashTable.erase(key);
-	if ( eraseCount < 1 ) {
-		// Could not erase
+	long position = findInBase(key);
+	if ( position < 0 ) {
 		return false;
 	}
-	// Delete was successful
+	merkle.erase(key, Entry::valueOf(base->valueAt(position)));
+	shadow(position);
 	return true;
 }
 
@@ -106,7 +167,7 @@ bool HashTable::deleteKey(string key) {
  * false otherwise
  */
 bool HashTable::isEmpty() {
-	return hashTable.empty();
+	return currentSize() == 0;
 }
 
 /**
@@ -118,7 +179,7 @@ bool HashTable::isEmpty() {
  * size of the table as unit
  */
 unsigned long HashTable::currentSize() {
-	return (unsigned  long)hashTable.size();
+	return engine->size() + baseVisible;
 }
 
 /**
@@ -127,7 +188,13 @@ unsigned long HashTable::currentSize() {
  * DESCRIPTION: Clear all contents from the hash table
  */
 void HashTable::clear() {
-	hashTable.clear();
+	engine->clear();
+	dropBase();
+	rebuildFilter();
+	merkle.clear();
+	if ( clock != NULL ) {
+		clock->clear();
+	}
 }
 
 /**
@@ -138,8 +205,29 @@ void HashTable::clear() {
  * RETURNS:
  * unsigned long count (Should be always 1)
  */
-unsigned long HashTable::count(string key) {
-	return (unsigned long) hashTable.count(key);
+unsigned long HashTable::count(const string &key) {
+	Slice record;
+	return lookupInEngine(key, &record) || findInBase(key) >= 0 ? 1 : 0;
+}
+
+/**
+ * FUNCTION: retPairs
+ *
+ * DESCRIPTION: This function returns all KV pairs stored as the given replica type.
+ * 				Prefer scanReplica() where a copy of the pairs is not needed.
+ *
+ * RETURN:
+ * vector<string>
+ */
+vector<pair<string, string>> HashTable::retPairs(ReplicaType replica) {
+	vector<pair<string, string>> pairs;
+
+	pairs.reserve(countReplica(replica));
+	scanRecords((unsigned char)replica, [&](const Slice &key, const Slice &record) {
+		pairs.emplace_back(key.toString(), Entry::valueOf(record).toString());
+		return true;
+	});
+	return pairs;
 }
 
 /**
@@ -151,16 +239,7 @@ unsigned long HashTable::count(string key) {
  * vector<string>
  */
 vector<pair<string, string>> HashTable::retPrimaryPairs() {
-	vector<pair<string, string>> primaryPairs;
-
-	for ( auto it = hashTable.begin(); it != hashTable.end(); ++it ) {
-		Entry entry(it->second);
-		if ( PRIMARY == entry.replica ) {
-			pair<string, string> temp= make_pair(it->first, entry.value);
-			primaryPairs.emplace_back(temp);
-		}
-	}
-	return primaryPairs;
+	return retPairs(PRIMARY);
 }
 
 /**
@@ -172,16 +251,7 @@ vector<pair<string, string>> HashTable::retPrimaryPairs() {
  * vector<string>
  */
 vector<pair<string, string>> HashTable::retSecondaryPairs() {
-	vector<pair<string, string>> secondaryPairs;
-
-	for ( auto it = hashTable.begin(); it != hashTable.end(); ++it ) {
-			Entry entry(it->second);
-			if ( SECONDARY == entry.replica ) {
-			pair<string, string> temp= make_pair(it->first, entry.value);
-			secondaryPairs.emplace_back(temp);
-		}
-	}
-	return secondaryPairs;
+	return retPairs(SECONDARY);
 }
 
 /**
@@ -193,16 +263,406 @@ vector<pair<string, string>> HashTable::retSecondaryPairs() {
  * vector<string>
  */
 vector<pair<string, string>> HashTable::retTertiaryPairs() {
-	vector<pair<string, string>> tertiaryPairs;
+	return retPairs(TERTIARY);
+}
+
+/**
+ * FUNCTION: scan
+ *
+ * DESCRIPTION: This function calls visit on every stored key with its decoded entry.
+ * 				The same Entry object is reused for every call.
+ */
+void HashTable::scan(const function<void(const string &, const Entry &)> &visit) {
+	Entry entry;
+
+	engine->scan([&](const Slice &key, const Slice &record) {
+		entry.decode(record);
+		visit(key.toString(), entry);
+	});
+	for ( unsigned long i = 0; base != NULL && i < base->size(); i++ ) {
+		if ( !shadowed[i] ) {
+			entry.decode(base->valueAt(i));
+			visit(base->keyAt(i).toString(), entry);
+		}
+	}
+}
+
+/**
+ * FUNCTION: scanReplica
+ *
+ * DESCRIPTION: This function walks the keys stored as the given replica type through the
+ * 				replica index, so it costs O(matching keys). Iteration stops as soon as visit
+ * 				returns false. visit must not modify the hash table.
+ */
+void HashTable::scanReplica(ReplicaType replica, const function<bool(const string &, const Entry &)> &visit) {
+	Entry entry;
+
+	scanRecords((unsigned char)replica, [&](const Slice &key, const Slice &record) {
+		entry.decode(record);
+		return visit(key.toString(), entry);
+	});
+}
+
+/**
+ * FUNCTION: countReplica
+ *
+ * DESCRIPTION: Returns the number of keys stored as the given replica type
+ */
+unsigned long HashTable::countReplica(ReplicaType replica) {
+	return engine->countTag((unsigned char)replica) + baseTagCounts[(unsigned char)replica];
+}
 
-	for ( auto it = hashTable.begin(); it != hashTable.end(); ++it ) {
-			Entry entry(it->second);
-			if ( TERTIARY == entry.replica ) {
-			pair<string, string> temp= make_pair(it->first, entry.value);
-			tertiaryPairs.emplace_back(temp);
+/**
+ * FUNCTION: scanRecords
+ *
+ * DESCRIPTION: Visit the raw records with the tag, in the engine and then in the visible part of
+ * 				the snapshot, until visit returns false. The snapshot side is picked out with
+ * 				its tag block, so no value is read unless it matches.
+ */
+void HashTable::scanRecords(unsigned char tag, const function<bool(const Slice &, const Slice &)> &visit) {
+	bool more = true;
+
+	engine->scanTag(tag, [&](const Slice &key, const Slice &record) {
+		more = visit(key, record);
+		return more;
+	});
+	for ( unsigned long i = 0; more && base != NULL && i < base->size(); i++ ) {
+		if ( !shadowed[i] && base->tagAt(i) == tag ) {
+			more = visit(base->keyAt(i), base->valueAt(i));
 		}
 	}
-	return tertiaryPairs;
 }
 
+/**
+ * FUNCTION: compact
+ *
+ * DESCRIPTION: Give memory freed by deletes and updates back if enough of it has piled up, and
+ * 				rebuild the Bloom filter once most of the keys it holds are gone.
+ * 				Meant to be called periodically; it is a cheap check when there is nothing to do.
+ *
+ * RETURN:
+ * true if the storage or the filter was compacted
+ */
+bool HashTable::compact() {
+	bool compacted = engine->compact();
+	if ( filterKeys > HASHTABLE_FILTER_MIN_KEYS && filterKeys > 2 * engine->size() ) {
+		rebuildFilter();
+		compacted = true;
+	}
+	return compacted;
+}
 
+/**
+ * FUNCTION: getStats
+ *
+ * DESCRIPTION: Fill stats with the memory footprint of the hash table
+ */
+void HashTable::getStats(StorageStats *stats) {
+	engine->getStats(stats);
+	stats->keys += baseVisible;
+	stats->indexBytes += filter.memoryBytes();
+	stats->filterNegatives += filterNegatives;
+	stats->filterFalsePositives += filterFalsePositives;
+	if ( base != NULL ) {
+		stats->mappedBytes += base->mappedBytes();
+		stats->indexBytes += shadowed.capacity() / 8;
+	}
+}
+
+/**
+ * FUNCTION: loadSnapshot
+ *
+ * DESCRIPTION: Mount a snapshot file as the read-only base layer of an empty hash table.
+ * 				Only the file's index is checked, so this costs next to nothing however
+ * 				many keys the snapshot holds.
+ *
+ * RETURN:
+ * false if the table is not empty or path holds no usable snapshot
+ */
+bool HashTable::loadSnapshot(const string &path) {
+	if ( !isEmpty() ) {
+		return false;
+	}
+	Snapshot *snapshot = new Snapshot();
+	if ( !snapshot->open(path) ) {
+		delete snapshot;
+		return false;
+	}
+	dropBase();
+	base = snapshot;
+	shadowed.assign(base->size(), false);
+	baseVisible = base->size();
+	for ( unsigned long i = 0; i < base->size(); i++ ) {
+		baseTagCounts[base->tagAt(i)]++;
+	}
+	rebuildMerkle();
+	return true;
+}
+
+/**
+ * FUNCTION: writeSnapshot
+ *
+ * DESCRIPTION: Write every visible key to a snapshot file at path. The pairs are handed to the
+ * 				writer in place, so nothing is copied besides the file itself, unless the engine
+ * 				only keeps them valid during its scan.
+ *
+ * RETURN:
+ * false if the snapshot could not be written
+ */
+bool HashTable::writeSnapshot(const string &path) {
+	vector<SnapshotItem> items;
+	SnapshotItem item;
+	// deque elements never move, so slices into them stay valid
+	deque<string> copies;
+	bool copy = !engine->scanSlicesOutlive();
+
+	items.reserve(currentSize());
+	engine->scan([&](const Slice &key, const Slice &record) {
+		item.key = key;
+		item.value = record;
+		if ( copy ) {
+			copies.push_back(key.toString());
+			item.key = Slice(copies.back());
+			copies.push_back(record.toString());
+			item.value = Slice(copies.back());
+		}
+		item.tag = (unsigned char)Entry::replicaOf(record);
+		items.push_back(item);
+	});
+	for ( unsigned long i = 0; base != NULL && i < base->size(); i++ ) {
+		if ( !shadowed[i] ) {
+			item.key = base->keyAt(i);
+			item.value = base->valueAt(i);
+			item.tag = base->tagAt(i);
+			items.push_back(item);
+		}
+	}
+	return Snapshot::write(path, items);
+}
+
+/**
+ * FUNCTION: findInBase
+ *
+ * DESCRIPTION: Position of the key in the snapshot, -1 if absent or shadowed
+ */
+long HashTable::findInBase(const string &key) {
+	if ( base == NULL ) {
+		return -1;
+	}
+	if ( !base->mayContain(key) ) {
+		filterNegatives++;
+		return -1;
+	}
+	long position = base->find(key);
+	if ( position < 0 ) {
+		filterFalsePositives++;
+		return -1;
+	}
+	if ( shadowed[position] ) {
+		return -1;
+	}
+	return position;
+}
+
+/**
+ * FUNCTION: shadow
+ *
+ * DESCRIPTION: Hide a snapshot key that has been updated or deleted since
+ */
+void HashTable::shadow(unsigned long position) {
+	shadowed[position] = true;
+	baseVisible--;
+	baseTagCounts[base->tagAt(position)]--;
+}
+
+/**
+ * FUNCTION: dropBase
+ *
+ * DESCRIPTION: Unmount the snapshot, if any
+ */
+void HashTable::dropBase() {
+	delete base;
+	base = NULL;
+	vector<bool>().swap(shadowed);
+	baseVisible = 0;
+	memset(baseTagCounts, 0, sizeof(baseTagCounts));
+}
+
+/**
+ * FUNCTION: mayBeInEngine
+ *
+ * DESCRIPTION: Ask the Bloom filter whether the engine may hold the key. Callers that go on to
+ * 				search the engine count a miss there as a false positive themselves.
+ *
+ * RETURN:
+ * false if the engine definitely does not hold the key
+ */
+bool HashTable::mayBeInEngine(const string &key) {
+	if ( !filter.mayContain(key) ) {
+		filterNegatives++;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION: lookupInEngine
+ *
+ * DESCRIPTION: Look the key up in the engine unless the Bloom filter rules it out
+ *
+ * RETURN:
+ * true and the record if the engine holds the key
+ */
+bool HashTable::lookupInEngine(const string &key, Slice *record) {
+	if ( !mayBeInEngine(key) ) {
+		return false;
+	}
+	if ( !engine->lookup(key, record) ) {
+		filterFalsePositives++;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION: addToFilter
+ *
+ * DESCRIPTION: Record a key inserted into the engine. The filter is rebuilt, twice as large,
+ * 				once it holds more keys than it was sized for.
+ */
+void HashTable::addToFilter(const string &key) {
+	filter.add(key);
+	if ( ++filterKeys > filterCapacity ) {
+		rebuildFilter();
+	}
+}
+
+/**
+ * FUNCTION: rebuildFilter
+ *
+ * DESCRIPTION: Rebuild the Bloom filter from the keys in the engine, sized for twice as many
+ */
+void HashTable::rebuildFilter() {
+	filterCapacity = max((unsigned long)HASHTABLE_FILTER_MIN_KEYS, 2 * engine->size());
+	filter.reset(filterCapacity);
+	engine->scan([&](const Slice &key, const Slice &) {
+		filter.add(key);
+	});
+	filterKeys = engine->size();
+}
+
+/**
+ * FUNCTION: charge
+ *
+ * DESCRIPTION: Count a pair written to the engine against the memory budget
+ */
+void HashTable::charge(const string &key, const string &record) {
+	if ( clock != NULL ) {
+		clock->charge(key, key.size() + record.size());
+	}
+}
+
+/**
+ * FUNCTION: setMemoryBudget
+ *
+ * DESCRIPTION: Cap the key and value bytes held in the engine, 0 for no cap. Keys already stored
+ * 				are tracked from now on; the snapshot base is mapped, not held, and is not charged.
+ */
+void HashTable::setMemoryBudget(unsigned long bytes) {
+	delete clock;
+	clock = NULL;
+	if ( bytes == 0 ) {
+		return;
+	}
+	clock = new ClockEviction(bytes);
+	engine->scan([&](const Slice &key, const Slice &record) {
+		clock->charge(key.toString(), key.size + record.size);
+	});
+}
+
+/**
+ * FUNCTION: touch
+ *
+ * DESCRIPTION: Record a client access to the key, so eviction passes it over once
+ */
+void HashTable::touch(const string &key) {
+	if ( clock != NULL ) {
+		clock->touch(key);
+	}
+}
+
+/**
+ * FUNCTION: evict
+ *
+ * DESCRIPTION: Delete one cold key if the engine holds more than the memory budget.
+ * 				Call until it returns false to get back under the budget.
+ *
+ * RETURN:
+ * true and the evicted key
+ * false if the table is within its budget, or has none
+ */
+bool HashTable::evict(string *key) {
+	if ( clock == NULL || !clock->overBudget() || !clock->victim(key) ) {
+		return false;
+	}
+	if ( !deleteKey(*key) ) {
+		// not stored after all; stop tracking it so the sweep moves on
+		clock->remove(*key);
+	}
+	clock->countEviction();
+	return true;
+}
+
+/**
+ * FUNCTION: getEvictionStats
+ *
+ * DESCRIPTION: Fill stats with the state of the memory budget; all zero if there is none
+ */
+void HashTable::getEvictionStats(EvictionStats *stats) {
+	if ( clock == NULL ) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+	clock->getStats(stats);
+}
+
+/**
+ * FUNCTION: setMerkleRanges
+ *
+ * DESCRIPTION: Keep a Merkle tree of each ring range from now on, ends[r] being the last
+ * 				position of range r as in the ring; the trees are built from every visible key.
+ * 				No ranges stops the upkeep.
+ */
+void HashTable::setMerkleRanges(const vector<uint64_t> &ends) {
+	merkle.reset(ends);
+	rebuildMerkle();
+}
+
+/**
+ * FUNCTION: getMerkleTree
+ *
+ * DESCRIPTION: The Merkle trees of the ring ranges, as up to date as the last write
+ */
+const MerkleTree &HashTable::getMerkleTree() {
+	return merkle;
+}
+
+/**
+ * FUNCTION: rebuildMerkle
+ *
+ * DESCRIPTION: Fill the Merkle trees from the engine and the visible part of the snapshot
+ */
+void HashTable::rebuildMerkle() {
+	if ( !merkle.active() ) {
+		return;
+	}
+	merkle.clear();
+	engine->scan([&](const Slice &key, const Slice &record) {
+		merkle.insert(key, Entry::valueOf(record));
+	});
+	for ( unsigned long i = 0; base != NULL && i < base->size(); i++ ) {
+		if ( !shadowed[i] ) {
+			merkle.insert(base->keyAt(i), Entry::valueOf(base->valueAt(i)));
+		}
+	}
+}
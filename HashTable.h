@@ -13,29 +13,94 @@
 #include "stdincludes.h"
 #include "common.h"
 #include "Entry.h"
+#include "StorageEngine.h"
+#include "Snapshot.h"
+#include "BloomFilter.h"
+#include "ClockEviction.h"
+#include "MerkleTree.h"
+
+/*
+ * Macros
+ */
+// smallest number of keys the engine Bloom filter is sized for
+#define HASHTABLE_FILTER_MIN_KEYS 1024
 
 /**
  * CLASS NAME: HashTable
  *
- * DESCRIPTION: This class is a wrapper to the map provided by C++ STL.
+ * DESCRIPTION: This class is a wrapper around a StorageEngine. The flat open-addressing
+ * 				engine is used unless another backend is asked for.
+ * 				Entries are stored as packed binary records (see Entry::encode) and indexed by
+ * 				ReplicaType, so a replica scan costs O(matching keys).
+ * 				The flat engine keeps the key and value bytes in a SlabArena; compact() should
+ * 				be called periodically to give memory freed by deletes back.
+ * 				A snapshot can be mounted as a read-only base layer under the engine: reads fall
+ * 				through to it, and keys updated or deleted afterwards are shadowed in a bitmap, so
+ * 				a visible base key is never also in the engine.
+ * 				Lookups ask a Bloom filter of the engine keys, and the snapshot's own filter,
+ * 				before searching either layer, so misses are cheap whatever the backend.
+ * 				With a memory budget set, the key and value bytes written to the engine are
+ * 				tracked for CLOCK eviction; evict() must then be called after writes.
+ * 				Once ring ranges are set, a Merkle tree of each range is kept up to date on every
+ * 				write for anti-entropy between replicas.
  *
  */
 class HashTable {
+private:
+	StorageEngine *engine;
+	// read-only base layer mapped from a snapshot, NULL if none
+	Snapshot *base;
+	// base positions updated or deleted since the snapshot was mounted
+	vector<bool> shadowed;
+	unsigned long baseVisible;
+	unsigned long baseTagCounts[256];
+	// Bloom filter of the keys inserted into the engine since it was last rebuilt
+	BloomFilter filter;
+	unsigned long filterKeys;
+	unsigned long filterCapacity;
+	unsigned long filterNegatives;
+	unsigned long filterFalsePositives;
+	// tracks the engine keys against the memory budget, NULL if there is none
+	ClockEviction *clock;
+	// digests of the pairs in each ring range, empty until ranges are set
+	MerkleTree merkle;
+	vector<pair<string, string> > retPairs(ReplicaType replica);
+	void scanRecords(unsigned char tag, const function<bool(const Slice &, const Slice &)> &visit);
+	long findInBase(const string &key);
+	void shadow(unsigned long position);
+	void dropBase();
+	bool mayBeInEngine(const string &key);
+	bool lookupInEngine(const string &key, Slice *record);
+	void addToFilter(const string &key);
+	void rebuildFilter();
+	void charge(const string &key, const string &record);
+	void rebuildMerkle();
 public:
-	map<string, string> hashTable;
-//public:
-	HashTable();
-	bool create(string key, string value);
-	string read(string key);
-	bool update(string key, string newValue);
-	bool deleteKey(string key);
+	HashTable(StorageEngineType engineType = FLAT_HASH_ENGINE, const string &directory = "");
+	bool create(const string &key, const Entry &entry);
+	bool read(const string &key, Entry *entry);
+	bool update(const string &key, const Entry &entry);
+	bool deleteKey(const string &key);
 	bool isEmpty();
 	unsigned long currentSize();
 	void clear();
-	unsigned long count(string key);
+	unsigned long count(const string &key);
 	vector<pair<string, string> > retPrimaryPairs();
 	vector<pair<string, string> > retSecondaryPairs();
 	vector<pair<string, string> > retTertiaryPairs();
+	void scan(const function<void(const string &, const Entry &)> &visit);
+	void scanReplica(ReplicaType replica, const function<bool(const string &, const Entry &)> &visit);
+	unsigned long countReplica(ReplicaType replica);
+	bool compact();
+	void getStats(StorageStats *stats);
+	bool loadSnapshot(const string &path);
+	bool writeSnapshot(const string &path);
+	void setMemoryBudget(unsigned long bytes);
+	void touch(const string &key);
+	bool evict(string *key);
+	void getEvictionStats(EvictionStats *stats);
+	void setMerkleRanges(const vector<uint64_t> &ends);
+	const MerkleTree &getMerkleTree();
 	virtual ~HashTable();
 };
 
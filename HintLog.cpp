@@ -0,0 +1,172 @@
+/**********************************
+ * FILE NAME: HintLog.cpp
+ *
+ * DESCRIPTION: Definition of the HintLog class
+ **********************************/
+
+#include "HintLog.h"
+
+/**
+ * constructor
+ */
+HintLog::HintLog(): records(0), file(NULL) {}
+
+/**
+ * Destructor
+ */
+HintLog::~HintLog() {
+	// Flushes anything still buffered
+	delete file;
+}
+
+/**
+ * FUNCTION NAME: recover
+ *
+ * DESCRIPTION: Take back the hints an earlier run left in the file at path, as if held now, then
+ * 				keep appending every change to it. A torn or corrupt tail is cut off (see
+ * 				WriteAheadLog::replay).
+ *
+ * RETURNS:
+ * number of records replayed
+ */
+unsigned long HintLog::recover(const string &path, int now) {
+	delete file;
+	file = new WriteAheadLog(path);
+	unsigned long replayed = file->replay([&](WalOp op, const Slice &key, const Slice &value) {
+		string name = key.toString();
+		size_t end = name.find('\0');
+		if ( op == WAL_CREATE && end != string::npos ) {
+			hold(name.substr(0, end), name.substr(end + 1), value.toString(), now);
+		}
+		else if ( op == WAL_DELETE ) {
+			drop(name, NULL);
+		}
+	});
+	if ( !file->open() ) {
+		// the hints of this run stay in memory only
+		delete file;
+		file = NULL;
+	}
+	return replayed;
+}
+
+/**
+ * FUNCTION NAME: commit
+ *
+ * DESCRIPTION: Write the changes made since the last commit to the file, with one fsync
+ *
+ * RETURNS:
+ * false if they could not be made durable
+ */
+bool HintLog::commit() {
+	return file == NULL || file->commit();
+}
+
+/**
+ * FUNCTION NAME: getPath
+ *
+ * DESCRIPTION: The file the hints are kept in, empty if they are kept in memory only
+ */
+const string &HintLog::getPath() {
+	static const string none;
+	return file == NULL ? none : file->getPath();
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Hold the entry record of a write of a key for its replica owner, unless the one
+ * 				held already was written later
+ */
+void HintLog::add(const Address &owner, const string &key, const string &record, int now) {
+	string address = owner.getAddress();
+	if ( hold(address, key, record, now) && file != NULL ) {
+		file->append(WAL_CREATE, address + '\0' + key, record);
+	}
+}
+
+/**
+ * FUNCTION NAME: hold
+ *
+ * DESCRIPTION: Keep a hint in memory
+ *
+ * RETURNS:
+ * false if a hint of the key written later is held already
+ */
+bool HintLog::hold(const string &owner, const string &key, const string &record, int now) {
+	lastHeld[owner] = now;
+	map<string, string> &held = hints[owner];
+	string &current = held[key];
+	if ( current.empty() ) {
+		records++;
+	}
+	else {
+		Entry older, newer;
+		if ( older.decode(Slice(current)) && newer.decode(Slice(record)) && older.timestamp > newer.timestamp ) {
+			return false;
+		}
+	}
+	current = record;
+	return true;
+}
+
+bool HintLog::empty() const {
+	return records == 0;
+}
+
+size_t HintLog::size() const {
+	return records;
+}
+
+/**
+ * FUNCTION NAME: owners
+ *
+ * DESCRIPTION: The replicas hints are held for
+ */
+vector<Address> HintLog::owners() const {
+	vector<Address> addresses;
+	for ( auto it = hints.begin(); it != hints.end(); it++ ) {
+		addresses.push_back(Address(it->first));
+	}
+	return addresses;
+}
+
+int HintLog::heldAt(const Address &owner) const {
+	auto it = lastHeld.find(owner.getAddress());
+	return it == lastHeld.end() ? -1 : it->second;
+}
+
+map<string, string> HintLog::take(const Address &owner) {
+	map<string, string> held;
+	if ( drop(owner.getAddress(), &held) > 0 && file != NULL ) {
+		file->append(WAL_DELETE, owner.getAddress(), Slice());
+		// nothing is held, and every hint still buffered is followed by its hand-over
+		if ( records == 0 ) {
+			file->reset();
+		}
+	}
+	return held;
+}
+
+/**
+ * FUNCTION NAME: drop
+ *
+ * DESCRIPTION: Forget the hints held in memory for a replica, moving them to held if given
+ *
+ * RETURNS:
+ * number of hints dropped
+ */
+size_t HintLog::drop(const string &owner, map<string, string> *held) {
+	lastHeld.erase(owner);
+	auto it = hints.find(owner);
+	if ( it == hints.end() ) {
+		return 0;
+	}
+	size_t dropped = it->second.size();
+	records -= dropped;
+	if ( held != NULL ) {
+		held->swap(it->second);
+	}
+	hints.erase(it);
+	return dropped;
+}
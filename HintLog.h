@@ -0,0 +1,56 @@
+/**********************************
+ * FILE NAME: HintLog.h
+ *
+ * DESCRIPTION: Header file of the HintLog class, writes held for replicas that are down
+ **********************************/
+
+#ifndef HINTLOG_H_
+#define HINTLOG_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include "Entry.h"
+#include "WriteAheadLog.h"
+
+/**
+ * CLASS NAME: HintLog
+ *
+ * DESCRIPTION: Writes a node took in for a replica that was down, kept apart from its hash table
+ * 				until they are handed to that replica. Hints are grouped by the replica they are
+ * 				meant for and hold one binary entry record per key: a newer write of a key
+ * 				replaces its hint, so a key written many times while its replica is down costs
+ * 				one record.
+ * 				Once recover() has been called the hints are also kept in a file, in the record
+ * 				format of WriteAheadLog and with its checksums and torn tail handling. A held hint
+ * 				is a WAL_CREATE record of "owner address\0key" and the entry record; handing the
+ * 				hints of a replica over is a WAL_DELETE record of its address. Like the
+ * 				write-ahead log, the file reaches the disk at commit(), once per tick, and it is
+ * 				emptied whenever no hints are left.
+ */
+class HintLog {
+private:
+	// entry records by key, by address of the replica they are meant for
+	map<string, map<string, string> > hints;
+	// tick the last hint for each replica was held
+	map<string, int> lastHeld;
+	size_t records;
+	// NULL while the hints are kept in memory only
+	WriteAheadLog *file;
+	bool hold(const string &owner, const string &key, const string &record, int now);
+	size_t drop(const string &owner, map<string, string> *held);
+public:
+	HintLog();
+	unsigned long recover(const string &path, int now);
+	bool commit();
+	const string &getPath();
+	void add(const Address &owner, const string &key, const string &record, int now);
+	int heldAt(const Address &owner) const;
+	bool empty() const;
+	size_t size() const;
+	vector<Address> owners() const;
+	// hand over the hints of a replica, which are forgotten
+	map<string, string> take(const Address &owner);
+	virtual ~HintLog();
+};
+
+#endif /* HINTLOG_H_ */
@@ -0,0 +1,757 @@
+/**********************************
+ * FILE NAME: LSMEngine.cpp
+ *
+ * DESCRIPTION: Log-structured merge-tree storage engine definition
+ **********************************/
+
+#include "LSMEngine.h"
+#include <dirent.h>
+#include <sys/stat.h>
+
+/**
+ * CLASS NAME: LSMEngine::MemTableIterator
+ *
+ * DESCRIPTION: Iterator over a memtable, which is already in key order
+ */
+class LSMEngine::MemTableIterator : public LSMIterator {
+private:
+	MemTable::const_iterator it;
+	MemTable::const_iterator end;
+public:
+	MemTableIterator(const MemTable &table): it(table.begin()), end(table.end()) {}
+	bool valid() const { return it != end; }
+	void next() { ++it; }
+	Slice key() const { return Slice(it->first); }
+	Slice value() const { return Slice(it->second.value); }
+	unsigned char tag() const { return it->second.tag; }
+	bool deleted() const { return it->second.deleted; }
+};
+
+/**
+ * CLASS NAME: LSMEngine::LevelIterator
+ *
+ * DESCRIPTION: Iterator over a level below 0: its tables have disjoint key ranges and are kept
+ * 				in key order, so they are simply read one after the other
+ */
+class LSMEngine::LevelIterator : public LSMIterator {
+private:
+	const Level &level;
+	size_t table;
+	unique_ptr<TableIterator> it;
+
+	void skipExhausted() {
+		while ( (!it || !it->valid()) && table < level.size() ) {
+			it.reset(new TableIterator(level[table++].get()));
+		}
+	}
+public:
+	LevelIterator(const Level &level): level(level), table(0) {
+		skipExhausted();
+	}
+	bool valid() const { return it && it->valid(); }
+	void next() { it->next(); skipExhausted(); }
+	Slice key() const { return it->key(); }
+	Slice value() const { return it->value(); }
+	unsigned char tag() const { return it->tag(); }
+	bool deleted() const { return it->deleted(); }
+};
+
+/**
+ * CLASS NAME: LSMEngine::MergingIterator
+ *
+ * DESCRIPTION: Merges iterators given newest first into one stream of unique keys. When several
+ * 				inputs hold a key, the newest one wins and the older copies are skipped.
+ */
+class LSMEngine::MergingIterator : public LSMIterator {
+private:
+	vector<LSMIterator *> children;
+	int current;
+	string currentKey;
+
+	void findSmallest() {
+		current = -1;
+		for ( int i = 0; i < (int)children.size(); i++ ) {
+			// strictly smaller, so ties go to the newer input
+			if ( children[i]->valid() && (current < 0 || compareKeys(children[i]->key(), children[current]->key()) < 0) ) {
+				current = i;
+			}
+		}
+	}
+public:
+	MergingIterator(const vector<LSMIterator *> &children): children(children) {
+		findSmallest();
+	}
+	~MergingIterator() {
+		for ( size_t i = 0; i < children.size(); i++ ) {
+			delete children[i];
+		}
+	}
+	bool valid() const { return current >= 0; }
+	void next() {
+		Slice key = children[current]->key();
+		currentKey.assign(key.data, key.size);
+		for ( size_t i = 0; i < children.size(); i++ ) {
+			if ( children[i]->valid() && children[i]->key() == Slice(currentKey) ) {
+				children[i]->next();
+			}
+		}
+		findSmallest();
+	}
+	Slice key() const { return children[current]->key(); }
+	Slice value() const { return children[current]->value(); }
+	unsigned char tag() const { return children[current]->tag(); }
+	bool deleted() const { return children[current]->deleted(); }
+};
+
+/**
+ * constructor
+ */
+LSMEngine::LSMEngine(const string &directory): directory(directory), memtableBytes(0), immutableBytes(0),
+		current(new Version()), cache(LSM_BLOCK_CACHE_BYTES), count(0), payloadBytes(0),
+		busy(false), stopping(false), broken(false), nextTableId(1),
+		filterNegatives(0), filterFalsePositives(0) {
+	memset(tagCounts, 0, sizeof(tagCounts));
+	mkdir(directory.c_str(), 0755);
+	removeTableFiles();
+	worker = thread(&LSMEngine::backgroundWork, this);
+}
+
+/**
+ * Destructor
+ */
+LSMEngine::~LSMEngine() {
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	workReady.notify_all();
+	worker.join();
+	for ( int l = 0; l < LSM_MAX_LEVELS; l++ ) {
+		for ( size_t i = 0; i < current->levels[l].size(); i++ ) {
+			current->levels[l][i]->markObsolete();
+		}
+	}
+	current.reset();
+	rmdir(directory.c_str());
+}
+
+/**
+ * FUNCTION NAME: tablePath
+ *
+ * DESCRIPTION: File name of a table
+ */
+string LSMEngine::tablePath(uint64_t id) const {
+	return directory + "/" + to_string(id) + ".sst";
+}
+
+/**
+ * FUNCTION NAME: removeTableFiles
+ *
+ * DESCRIPTION: Delete tables left in the directory by an earlier run
+ */
+void LSMEngine::removeTableFiles() {
+	DIR *dir = opendir(directory.c_str());
+	if ( dir == NULL ) {
+		return;
+	}
+	struct dirent *file;
+	while ( (file = readdir(dir)) != NULL ) {
+		string name = file->d_name;
+		if ( name.size() > 4 && name.compare(name.size() - 4, 4, ".sst") == 0 ) {
+			unlink((directory + "/" + name).c_str());
+		}
+	}
+	closedir(dir);
+}
+
+/**
+ * FUNCTION NAME: get
+ *
+ * DESCRIPTION: Newest record of the key: memtable, immutable memtable, level 0 newest first,
+ * 				then the one table per level whose range covers the key
+ *
+ * RETURNS:
+ * true with the value and tag if the key is live
+ * false if it is absent or deleted
+ */
+bool LSMEngine::get(const Slice &key, Found *found) {
+	string search = key.toString();
+	MemTable::const_iterator it = memtable.find(search);
+	if ( it != memtable.end() ) {
+		found->value = it->second.value;
+		found->tag = it->second.tag;
+		return !it->second.deleted;
+	}
+
+	shared_ptr<const MemTable> frozen;
+	shared_ptr<const Version> version;
+	{
+		lock_guard<mutex> guard(lock);
+		frozen = immutable;
+		version = current;
+	}
+	if ( frozen ) {
+		it = frozen->find(search);
+		if ( it != frozen->end() ) {
+			found->value = it->second.value;
+			found->tag = it->second.tag;
+			return !it->second.deleted;
+		}
+	}
+
+	SSTable::Found record;
+	uint64_t keyHash = BloomFilter::hash(key);
+	const Level &level0 = version->levels[0];
+	for ( size_t i = 0; i < level0.size(); i++ ) {
+		if ( searchTable(*level0[i], key, keyHash, &record) ) {
+			found->value.swap(record.value);
+			found->tag = record.tag;
+			return !record.deleted;
+		}
+	}
+	for ( int l = 1; l < LSM_MAX_LEVELS; l++ ) {
+		const Level &level = version->levels[l];
+		// first table whose largest key is not below the key
+		size_t low = 0;
+		size_t high = level.size();
+		while ( low < high ) {
+			size_t mid = low + (high - low) / 2;
+			if ( compareKeys(level[mid]->largestKey(), key) < 0 ) {
+				low = mid + 1;
+			}
+			else {
+				high = mid;
+			}
+		}
+		if ( low < level.size() && searchTable(*level[low], key, keyHash, &record) ) {
+			found->value.swap(record.value);
+			found->tag = record.tag;
+			return !record.deleted;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: searchTable
+ *
+ * DESCRIPTION: Look the key up in one table, unless its key range or Bloom filter rules it out
+ *
+ * RETURNS:
+ * true with the record (possibly a tombstone) if the table holds the key
+ */
+bool LSMEngine::searchTable(const SSTable &table, const Slice &key, uint64_t keyHash, SSTable::Found *record) {
+	if ( !overlaps(table, key, key) ) {
+		return false;
+	}
+	if ( !table.mayContain(keyHash) ) {
+		filterNegatives++;
+		return false;
+	}
+	if ( !table.get(key, &cache, record) ) {
+		filterFalsePositives++;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: put
+ *
+ * DESCRIPTION: Write a record (or tombstone) to the memtable, rotating it out once it is full
+ */
+void LSMEngine::put(const Slice &key, const Slice &value, unsigned char tag, bool deleted) {
+	string k = key.toString();
+	MemTable::iterator it = memtable.find(k);
+	if ( it != memtable.end() ) {
+		memtableBytes -= it->second.value.size();
+		it->second.value.assign(value.data, value.size);
+		it->second.tag = tag;
+		it->second.deleted = deleted;
+	}
+	else {
+		MemValue item;
+		item.value.assign(value.data, value.size);
+		item.tag = tag;
+		item.deleted = deleted;
+		memtable.emplace(k, item);
+		memtableBytes += k.size() + LSM_MEMTABLE_OVERHEAD;
+	}
+	memtableBytes += value.size;
+	if ( memtableBytes >= LSM_MEMTABLE_BYTES ) {
+		rotateMemtable();
+	}
+}
+
+/**
+ * FUNCTION NAME: rotateMemtable
+ *
+ * DESCRIPTION: Hand the full memtable to the background thread and start a new one. If the
+ * 				previous one is still being flushed, writes stall until it is done. If the
+ * 				tables cannot be written at all the memtable just keeps growing.
+ */
+void LSMEngine::rotateMemtable() {
+	unique_lock<mutex> guard(lock);
+	workDone.wait(guard, [&] { return !immutable || broken; });
+	if ( broken ) {
+		return;
+	}
+	shared_ptr<MemTable> full = make_shared<MemTable>();
+	full->swap(memtable);
+	immutable = full;
+	immutableBytes = memtableBytes;
+	memtableBytes = 0;
+	workReady.notify_one();
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Insert the pair unless the key is live
+ */
+bool LSMEngine::insert(const Slice &key, const Slice &value, unsigned char tag) {
+	Found old;
+	if ( get(key, &old) ) {
+		return false;
+	}
+	put(key, value, tag, false);
+	count++;
+	tagCounts[tag]++;
+	payloadBytes += key.size + value.size;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: lookup
+ *
+ * DESCRIPTION: Point value at a copy of the stored value, valid until the next call
+ *
+ * RETURNS:
+ * false if the key is absent
+ */
+bool LSMEngine::lookup(const Slice &key, Slice *value) {
+	Found found;
+	if ( !get(key, &found) ) {
+		return false;
+	}
+	lookupValue.swap(found.value);
+	*value = Slice(lookupValue);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: assign
+ *
+ * DESCRIPTION: Overwrite the value and tag of a live key
+ */
+bool LSMEngine::assign(const Slice &key, const Slice &value, unsigned char tag, string *previous) {
+	Found old;
+	if ( !get(key, &old) ) {
+		return false;
+	}
+	put(key, value, tag, false);
+	tagCounts[old.tag]--;
+	tagCounts[tag]++;
+	payloadBytes = payloadBytes - old.value.size() + value.size;
+	if ( previous != NULL ) {
+		previous->swap(old.value);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Remove a live key by writing a tombstone over it
+ */
+bool LSMEngine::erase(const Slice &key, string *previous) {
+	Found old;
+	if ( !get(key, &old) ) {
+		return false;
+	}
+	put(key, Slice(), old.tag, true);
+	count--;
+	tagCounts[old.tag]--;
+	payloadBytes -= key.size + old.value.size();
+	if ( previous != NULL ) {
+		previous->swap(old.value);
+	}
+	return true;
+}
+
+unsigned long LSMEngine::size() {
+	return count;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drop everything. Waits for a running flush or compaction to finish first so it
+ * 				cannot install its output afterwards.
+ */
+void LSMEngine::clear() {
+	unique_lock<mutex> guard(lock);
+	workDone.wait(guard, [&] { return !busy; });
+	for ( int l = 0; l < LSM_MAX_LEVELS; l++ ) {
+		for ( size_t i = 0; i < current->levels[l].size(); i++ ) {
+			current->levels[l][i]->markObsolete();
+		}
+	}
+	current.reset(new Version());
+	immutable.reset();
+	immutableBytes = 0;
+	guard.unlock();
+	workDone.notify_all();
+
+	memtable.clear();
+	memtableBytes = 0;
+	cache.clear();
+	count = 0;
+	payloadBytes = 0;
+	memset(tagCounts, 0, sizeof(tagCounts));
+}
+
+/**
+ * FUNCTION NAME: mergeScan
+ *
+ * DESCRIPTION: Visit every live pair in key order until visit returns false, merging the
+ * 				memtables and every level
+ */
+void LSMEngine::mergeScan(const function<bool(const Slice &, const Slice &, unsigned char)> &visit) {
+	shared_ptr<const MemTable> frozen;
+	shared_ptr<const Version> version;
+	{
+		lock_guard<mutex> guard(lock);
+		frozen = immutable;
+		version = current;
+	}
+	vector<LSMIterator *> children;
+	children.push_back(new MemTableIterator(memtable));
+	if ( frozen ) {
+		children.push_back(new MemTableIterator(*frozen));
+	}
+	for ( size_t i = 0; i < version->levels[0].size(); i++ ) {
+		children.push_back(new TableIterator(version->levels[0][i].get()));
+	}
+	for ( int l = 1; l < LSM_MAX_LEVELS; l++ ) {
+		if ( !version->levels[l].empty() ) {
+			children.push_back(new LevelIterator(version->levels[l]));
+		}
+	}
+	MergingIterator merged(children);
+	for ( ; merged.valid(); merged.next() ) {
+		if ( !merged.deleted() && !visit(merged.key(), merged.value(), merged.tag()) ) {
+			return;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: scan
+ *
+ * DESCRIPTION: Visit every pair, in key order
+ */
+void LSMEngine::scan(const function<void(const Slice &, const Slice &)> &visit) {
+	mergeScan([&](const Slice &key, const Slice &value, unsigned char) {
+		visit(key, value);
+		return true;
+	});
+}
+
+/**
+ * FUNCTION NAME: scanTag
+ *
+ * DESCRIPTION: Visit the pairs with the tag, in key order
+ */
+void LSMEngine::scanTag(unsigned char tag, const function<bool(const Slice &, const Slice &)> &visit) {
+	mergeScan([&](const Slice &key, const Slice &value, unsigned char recordTag) {
+		return recordTag != tag || visit(key, value);
+	});
+}
+
+unsigned long LSMEngine::countTag(unsigned char tag) {
+	return tagCounts[tag];
+}
+
+/**
+ * FUNCTION NAME: getStats
+ *
+ * DESCRIPTION: Memtables and cached blocks are memory; tables are disk, except their block index
+ */
+void LSMEngine::getStats(StorageStats *stats) {
+	memset(stats, 0, sizeof(StorageStats));
+	stats->keys = count;
+	stats->payloadBytes = payloadBytes;
+	stats->filterNegatives = filterNegatives;
+	stats->filterFalsePositives = filterFalsePositives;
+
+	lock_guard<mutex> guard(lock);
+	stats->allocatedBytes = memtableBytes + (immutable ? immutableBytes : 0);
+	stats->reservedBytes = stats->allocatedBytes + cache.getUsage();
+	for ( int l = 0; l < LSM_MAX_LEVELS; l++ ) {
+		for ( size_t i = 0; i < current->levels[l].size(); i++ ) {
+			stats->indexBytes += current->levels[l][i]->indexBytes();
+			stats->diskBytes += current->levels[l][i]->fileSize();
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: waitForIdle
+ *
+ * DESCRIPTION: Block until every flush and compaction that is due has been done
+ */
+void LSMEngine::waitForIdle() {
+	unique_lock<mutex> guard(lock);
+	int level;
+	workDone.wait(guard, [&] {
+		return broken || (!busy && !immutable && !pickCompaction(*current, &level));
+	});
+}
+
+/**
+ * FUNCTION NAME: backgroundWork
+ *
+ * DESCRIPTION: Body of the background thread: flush the immutable memtable whenever there is
+ * 				one, otherwise run the most urgent compaction, otherwise sleep
+ */
+void LSMEngine::backgroundWork() {
+	unique_lock<mutex> guard(lock);
+	while ( !stopping ) {
+		shared_ptr<const MemTable> frozen = immutable;
+		shared_ptr<const Version> version = current;
+		int level = 0;
+		bool flush = (bool)frozen;
+		if ( broken || (!flush && !pickCompaction(*version, &level)) ) {
+			workDone.notify_all();
+			workReady.wait(guard);
+			continue;
+		}
+		busy = true;
+		guard.unlock();
+		bool ok = flush ? flushImmutable(*version, frozen) : compactLevel(*version, level);
+		guard.lock();
+		busy = false;
+		if ( !ok ) {
+			broken = true;
+		}
+		workDone.notify_all();
+	}
+}
+
+/**
+ * FUNCTION NAME: levelBytes
+ *
+ * DESCRIPTION: Total file size of a level
+ */
+uint64_t LSMEngine::levelBytes(const Level &level) {
+	uint64_t bytes = 0;
+	for ( size_t i = 0; i < level.size(); i++ ) {
+		bytes += level[i]->fileSize();
+	}
+	return bytes;
+}
+
+/**
+ * FUNCTION NAME: levelLimit
+ *
+ * DESCRIPTION: Size above which a level (1 and below) is compacted into the next one
+ */
+uint64_t LSMEngine::levelLimit(int level) {
+	uint64_t limit = LSM_LEVEL1_BYTES;
+	for ( int l = 1; l < level; l++ ) {
+		limit *= LSM_LEVEL_MULTIPLIER;
+	}
+	return limit;
+}
+
+/**
+ * FUNCTION NAME: overlaps
+ *
+ * DESCRIPTION: Whether the key range of the table meets [smallest, largest]
+ */
+bool LSMEngine::overlaps(const SSTable &table, const Slice &smallest, const Slice &largest) {
+	return compareKeys(table.largestKey(), smallest) >= 0 && compareKeys(table.smallestKey(), largest) <= 0;
+}
+
+/**
+ * FUNCTION NAME: pickCompaction
+ *
+ * DESCRIPTION: Level 0 is compacted once it has LSM_L0_COMPACTION_TRIGGER tables, every other
+ * 				level once it outgrows its limit; the shallowest such level goes first
+ *
+ * RETURNS:
+ * true and the level to compact if any compaction is due
+ */
+bool LSMEngine::pickCompaction(const Version &version, int *level) {
+	if ( version.levels[0].size() >= LSM_L0_COMPACTION_TRIGGER ) {
+		*level = 0;
+		return true;
+	}
+	for ( int l = 1; l < LSM_MAX_LEVELS - 1; l++ ) {
+		if ( levelBytes(version.levels[l]) > levelLimit(l) ) {
+			*level = l;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: writeTables
+ *
+ * DESCRIPTION: Write the records of input to new tables of about LSM_TABLE_BYTES each
+ *
+ * RETURNS:
+ * false if a table could not be written; any output written so far is discarded
+ */
+bool LSMEngine::writeTables(LSMIterator *input, bool dropTombstones, vector<shared_ptr<SSTable> > *outputs) {
+	unique_ptr<TableBuilder> builder;
+	uint64_t id = 0;
+	bool ok = true;
+
+	auto finishTable = [&]() {
+		bool written = builder->finish();
+		builder.reset();
+		shared_ptr<SSTable> table = make_shared<SSTable>(tablePath(id), id);
+		if ( written && table->open() ) {
+			outputs->push_back(table);
+			return true;
+		}
+		// unlinks the file once the table goes out of scope
+		table->markObsolete();
+		return false;
+	};
+
+	for ( ; ok && input->valid(); input->next() ) {
+		if ( dropTombstones && input->deleted() ) {
+			continue;
+		}
+		if ( !builder ) {
+			id = nextTableId++;
+			builder.reset(new TableBuilder(tablePath(id)));
+		}
+		builder->add(input->key(), input->value(), input->tag(), input->deleted());
+		if ( builder->fileSize() >= LSM_TABLE_BYTES ) {
+			ok = finishTable();
+		}
+	}
+	if ( ok && builder ) {
+		ok = finishTable();
+	}
+	if ( !ok ) {
+		for ( size_t i = 0; i < outputs->size(); i++ ) {
+			(*outputs)[i]->markObsolete();
+		}
+		outputs->clear();
+	}
+	return ok;
+}
+
+/**
+ * FUNCTION NAME: flushImmutable
+ *
+ * DESCRIPTION: Write the immutable memtable as level 0 table(s) and install them
+ */
+bool LSMEngine::flushImmutable(const Version &version, const shared_ptr<const MemTable> &table) {
+	vector<shared_ptr<SSTable> > outputs;
+	bool emptyTree = true;
+	for ( int l = 0; l < LSM_MAX_LEVELS; l++ ) {
+		emptyTree = emptyTree && version.levels[l].empty();
+	}
+	MemTableIterator input(*table);
+	// With nothing older on disk a tombstone has nothing left to hide
+	if ( !writeTables(&input, emptyTree, &outputs) ) {
+		return false;
+	}
+
+	lock_guard<mutex> guard(lock);
+	shared_ptr<Version> next = make_shared<Version>(*current);
+	next->levels[0].insert(next->levels[0].begin(), outputs.begin(), outputs.end());
+	current = next;
+	immutable.reset();
+	immutableBytes = 0;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: compactLevel
+ *
+ * DESCRIPTION: Merge tables of level into the overlapping tables of level + 1. Level 0 tables
+ * 				overlap each other, so all of them go at once; from deeper levels one table is
+ * 				taken per round, rotating through the key space.
+ */
+bool LSMEngine::compactLevel(const Version &version, int level) {
+	vector<shared_ptr<SSTable> > inputs;
+	if ( level == 0 ) {
+		inputs = version.levels[0];
+	}
+	else {
+		const Level &from = version.levels[level];
+		size_t pick = 0;
+		while ( pick < from.size() && !compactPointers[level].empty()
+				&& compareKeys(from[pick]->smallestKey(), Slice(compactPointers[level])) <= 0 ) {
+			pick++;
+		}
+		if ( pick == from.size() ) {
+			pick = 0;
+		}
+		inputs.push_back(from[pick]);
+		compactPointers[level] = from[pick]->largestKey().toString();
+	}
+
+	string smallest = inputs[0]->smallestKey().toString();
+	string largest = inputs[0]->largestKey().toString();
+	for ( size_t i = 1; i < inputs.size(); i++ ) {
+		if ( compareKeys(inputs[i]->smallestKey(), Slice(smallest)) < 0 ) {
+			smallest = inputs[i]->smallestKey().toString();
+		}
+		if ( compareKeys(inputs[i]->largestKey(), Slice(largest)) > 0 ) {
+			largest = inputs[i]->largestKey().toString();
+		}
+	}
+	vector<shared_ptr<SSTable> > below;
+	const Level &to = version.levels[level + 1];
+	for ( size_t i = 0; i < to.size(); i++ ) {
+		if ( overlaps(*to[i], Slice(smallest), Slice(largest)) ) {
+			below.push_back(to[i]);
+		}
+	}
+
+	// Inputs are newer than the level below them, and level 0 is already newest first
+	vector<LSMIterator *> children;
+	for ( size_t i = 0; i < inputs.size(); i++ ) {
+		children.push_back(new TableIterator(inputs[i].get()));
+	}
+	for ( size_t i = 0; i < below.size(); i++ ) {
+		children.push_back(new TableIterator(below[i].get()));
+	}
+	bool deepest = true;
+	for ( int l = level + 2; l < LSM_MAX_LEVELS; l++ ) {
+		deepest = deepest && version.levels[l].empty();
+	}
+	MergingIterator merged(children);
+	vector<shared_ptr<SSTable> > outputs;
+	if ( !writeTables(&merged, deepest, &outputs) ) {
+		return false;
+	}
+
+	lock_guard<mutex> guard(lock);
+	shared_ptr<Version> next = make_shared<Version>(*current);
+	Level &source = next->levels[level];
+	Level &target = next->levels[level + 1];
+	for ( size_t i = 0; i < inputs.size(); i++ ) {
+		source.erase(find(source.begin(), source.end(), inputs[i]));
+		inputs[i]->markObsolete();
+	}
+	for ( size_t i = 0; i < below.size(); i++ ) {
+		target.erase(find(target.begin(), target.end(), below[i]));
+		below[i]->markObsolete();
+	}
+	target.insert(target.end(), outputs.begin(), outputs.end());
+	sort(target.begin(), target.end(), [](const shared_ptr<SSTable> &first, const shared_ptr<SSTable> &second) {
+		return compareKeys(first->smallestKey(), second->smallestKey()) < 0;
+	});
+	current = next;
+	return true;
+}
@@ -0,0 +1,150 @@
+/**********************************
+ * FILE NAME: LSMEngine.h
+ *
+ * DESCRIPTION: Header file of the log-structured merge-tree storage engine
+ **********************************/
+
+#ifndef LSMENGINE_H_
+#define LSMENGINE_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include "StorageEngine.h"
+#include "SSTable.h"
+#include "BlockCache.h"
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/*
+ * Macros
+ */
+// memtable size that triggers a flush to level 0
+#define LSM_MEMTABLE_BYTES (4 << 20)
+// bookkeeping charged per memtable entry on top of its key and value
+#define LSM_MEMTABLE_OVERHEAD 64
+#define LSM_BLOCK_CACHE_BYTES (8 << 20)
+#define LSM_MAX_LEVELS 7
+// level 0 tables that trigger a compaction into level 1
+#define LSM_L0_COMPACTION_TRIGGER 4
+// size limit of level 1; each deeper level may hold LSM_LEVEL_MULTIPLIER times more
+#define LSM_LEVEL1_BYTES (10 << 20)
+#define LSM_LEVEL_MULTIPLIER 10
+// compaction output is split into tables of about this size
+#define LSM_TABLE_BYTES (2 << 20)
+
+/**
+ * CLASS NAME: LSMEngine
+ *
+ * DESCRIPTION: Log-structured merge-tree storage engine for data sets larger than memory.
+ * 				Writes go to a sorted in-memory memtable. A full memtable becomes immutable and a
+ * 				background thread flushes it to a level 0 SSTable, then merges tables down the
+ * 				levels (leveled compaction: every level below 0 is a sorted run of tables with
+ * 				disjoint key ranges, about LSM_LEVEL_MULTIPLIER times larger than the one above).
+ * 				Deletes are tombstones, dropped once they reach the deepest level in use.
+ * 				Lookups check the memtable, the immutable memtable, level 0 newest first, then one
+ * 				table per level, reading blocks through a shared LRU block cache. Every table has
+ * 				a Bloom filter, so a table without the key is almost never read.
+ * 				Inserts, updates and deletes run the same lookup first to keep the counts exact;
+ * 				a new key the filters rule out costs them no block read.
+ *
+ * 				The foreground (MP2Node) is the only writer. The set of tables is an immutable
+ * 				Version that the compaction thread replaces under the mutex, so readers take
+ * 				a reference and search it without holding any lock.
+ *
+ * 				The tables are scratch space, not a durable copy: the directory is emptied on
+ * 				start-up. Durability comes from the write-ahead log and snapshots above HashTable.
+ * 				Tags are counted but not indexed, so scanTag() filters a full merge.
+ */
+class LSMEngine : public StorageEngine {
+private:
+	struct MemValue {
+		string value;
+		unsigned char tag;
+		bool deleted;
+	};
+	typedef map<string, MemValue> MemTable;
+	typedef vector<shared_ptr<SSTable> > Level;
+	struct Version {
+		// level 0 newest first, other levels ordered by key
+		Level levels[LSM_MAX_LEVELS];
+	};
+	struct Found {
+		string value;
+		unsigned char tag;
+	};
+	class MemTableIterator;
+	class LevelIterator;
+	class MergingIterator;
+
+	string directory;
+	MemTable memtable;
+	size_t memtableBytes;
+	// full memtable waiting to be flushed, NULL if none
+	shared_ptr<const MemTable> immutable;
+	size_t immutableBytes;
+	shared_ptr<const Version> current;
+	BlockCache cache;
+	unsigned long count;
+	unsigned long payloadBytes;
+	unsigned long tagCounts[256];
+	// value returned by the last lookup()
+	string lookupValue;
+
+	// guards immutable, current, busy, stopping and broken
+	mutex lock;
+	condition_variable workReady;
+	condition_variable workDone;
+	thread worker;
+	bool busy;
+	bool stopping;
+	// set when a table could not be written; background work stops and the memtable grows
+	bool broken;
+	// only touched by the background thread
+	uint64_t nextTableId;
+	// largest key of the last table compacted out of each level
+	string compactPointers[LSM_MAX_LEVELS];
+	// table lookups the Bloom filters skipped, and ones they let through for nothing
+	unsigned long filterNegatives;
+	unsigned long filterFalsePositives;
+
+	bool get(const Slice &key, Found *found);
+	bool searchTable(const SSTable &table, const Slice &key, uint64_t keyHash, SSTable::Found *record);
+	void put(const Slice &key, const Slice &value, unsigned char tag, bool deleted);
+	void rotateMemtable();
+	string tablePath(uint64_t id) const;
+	void removeTableFiles();
+
+	// background thread
+	void backgroundWork();
+	bool pickCompaction(const Version &version, int *level);
+	bool flushImmutable(const Version &version, const shared_ptr<const MemTable> &table);
+	bool compactLevel(const Version &version, int level);
+	bool writeTables(LSMIterator *input, bool dropTombstones, vector<shared_ptr<SSTable> > *outputs);
+	static uint64_t levelBytes(const Level &level);
+	static uint64_t levelLimit(int level);
+	static bool overlaps(const SSTable &table, const Slice &smallest, const Slice &largest);
+	void mergeScan(const function<bool(const Slice &, const Slice &, unsigned char)> &visit);
+public:
+	LSMEngine(const string &directory);
+	bool insert(const Slice &key, const Slice &value, unsigned char tag);
+	bool lookup(const Slice &key, Slice *value);
+	bool assign(const Slice &key, const Slice &value, unsigned char tag, string *previous = NULL);
+	bool erase(const Slice &key, string *previous = NULL);
+	unsigned long size();
+	void clear();
+	void scan(const function<void(const Slice &, const Slice &)> &visit);
+	// scanned pairs point into table blocks that are read one at a time
+	bool scanSlicesOutlive() { return false; }
+	void scanTag(unsigned char tag, const function<bool(const Slice &, const Slice &)> &visit);
+	unsigned long countTag(unsigned char tag);
+	void getStats(StorageStats *stats);
+	// block until no flush or compaction is pending (used by tests and benchmarks)
+	void waitForIdle();
+	virtual ~LSMEngine();
+};
+
+#endif /* LSMENGINE_H_ */
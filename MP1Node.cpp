@@ -163,6 +163,7 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
         setIdAndPortFromAddress(memberNode->addr, &id, &port);
         MemberListEntry entry = MemberListEntry(id, port, 0, par->getcurrtime());
         memberNode->memberList.push_back(entry);
+        memberNode->membershipEpoch++;
 
         // log to debug log about new node join
         log->logNodeAdd(&memberNode->addr, &memberNode->addr);
@@ -202,6 +203,7 @@ int MP1Node::finishUpThisNode(){
     memberNode->nnb = 0;
     memberNode->heartbeat = 0;
     memberNode->memberList.clear();
+    memberNode->membershipEpoch++;
     return 0;
 }
 
@@ -274,6 +276,7 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
         setIdAndPortFromAddress(addr, &id, &port);
         MemberListEntry entry = MemberListEntry(id, port, heartbeat, par->getcurrtime());
         memberNode->memberList.push_back(entry);
+        memberNode->membershipEpoch++;
 
         // log to debug log about new node join
         log->logNodeAdd(&memberNode->addr, &addr);
@@ -285,6 +288,7 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
         memberNode->inGroup = true;
         // We just joined, so we should use introducer's membership list and clear anything previously stored.
         memberNode->memberList.clear();
+        memberNode->membershipEpoch++;
 
         // Now we deserialize the msg and update my member list
         deserializeAndUpdateMemberList(data, size);
@@ -350,6 +354,7 @@ void MP1Node::nodeLoopOps() {
         long timeSinceLastUpdate = currTime - neighbour->timestamp;
         if (hasFailed && currTime - failed[neighbour->id] >= TREMOVE) { // remove node
             neighbour = memberNode->memberList.erase(neighbour);
+            memberNode->membershipEpoch++;
             failed.erase(neighbour->id);
             log->logNodeRemove(&(memberNode->addr), &neighbourAddr);
             continue;
@@ -437,6 +442,7 @@ void MP1Node::deserializeAndUpdateMemberList(char *data, int size) {
 //        if (old == nullptr) {
             MemberListEntry entry = MemberListEntry(id, port, heartbeat, currTime);
             memberNode->memberList.push_back(entry);
+            memberNode->membershipEpoch++;
 
             // log the new mle join
             Address addr = createAddressFromIdAndPort(id, port);
@@ -486,6 +492,7 @@ Address MP1Node::getJoinAddress() {
  */
 void MP1Node::initMemberListTable(Member *memberNode) {
 	memberNode->memberList.clear();
+	memberNode->membershipEpoch++;
 }
 
 /**
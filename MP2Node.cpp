@@ -15,15 +15,61 @@ MP2Node::MP2Node(Member *memberNode, Params *par, EmulNet * emulNet, Log * log,
 	this->par = par;
 	this->emulNet = emulNet;
 	this->log = log;
-	ht = new HashTable();
 	this->memberNode->addr = *address;
+	// one behind, so the first updateRing() builds the ring
+	ringEpoch = memberNode->membershipEpoch - 1;
+	ht = new HashTable(par->STORAGE_ENGINE, nodeFileName(LSM_DIRECTORY_PREFIX, ""));
 	this->delimiter = "::";
+	wal = NULL;
+	expiries = new TimerWheel(par->getcurrtime());
+	tombstoneExpiries = new TimerWheel(par->getcurrtime());
+	tombstoneHorizon = max(OPERATION_TIMEOUT, TOMBSTONE_GC_ROUNDS * par->ANTI_ENTROPY_INTERVAL);
+	txTimeouts = new TimerWheel(par->getcurrtime());
+	hedges = new TimerWheel(par->getcurrtime());
+	hedgesFired = 0;
+	hedgesWon = 0;
+	txSlots.resize(TRANSACTION_SLOTS);
+	opLatencies.assign(OPERATION_TIMEOUT + 2, 0);
+	opFailures = 0;
+	lateReplies = 0;
+	readRepairs = 0;
+	readHits = 0;
+	readMisses = 0;
+	// replicas of a cache drop different keys, so there is nothing to reconcile
+	antiEntropy = par->ANTI_ENTROPY_INTERVAL > 0 && par->MEMORY_BUDGET == 0;
+	hintsStored = 0;
+	hintsRecovered = 0;
+	hintsReplayed = 0;
+	nextStreamId = 0;
+	streamsOpened = 0;
+	streamsCompleted = 0;
+	streamsAbandoned = 0;
+	recordsReceived = 0;
+	merkleRounds = 0;
+	merkleDigestsSent = 0;
+	merkleLeavesRepaired = 0;
+	if ( par->MEMORY_BUDGET > 0 ) {
+		ht->setMemoryBudget(par->MEMORY_BUDGET);
+	}
+	if ( par->WAL_ENABLED || par->SNAPSHOT_INTERVAL > 0 ) {
+		recoverFromDisk();
+		evictOverBudget();
+	}
+	if ( par->SLOPPY_QUORUM ) {
+		recoverHints();
+	}
 }
 
 /**
  * Destructor
  */
 MP2Node::~MP2Node() {
+	// Flushes anything still buffered
+	delete wal;
+	delete expiries;
+	delete tombstoneExpiries;
+	delete txTimeouts;
+	delete hedges;
 	delete ht;
 }
 
@@ -35,11 +81,19 @@ MP2Node::~MP2Node() {
 *                    The membership list is returned as a vector of Nodes. See Node class in Node.h
 *                 2) Constructs the ring based on the membership list
 *                 3) Calls the Stabilization Protocol
+*                 Steps 1 to 3 only run when MP1Node has added or removed a member since the
+*                 ring was last built, so ticks without membership changes cost O(1)
 */
 void MP2Node::updateRing() {
     vector<Node> curMemList;
     bool change = false;
 
+	if ( memberNode->membershipEpoch == ringEpoch ) {
+		updateTransactionMap();
+		return;
+	}
+	ringEpoch = memberNode->membershipEpoch;
+
 	/*
 	 *  Step 1. Get the current membership list from Membership Protocol / MP1
 	 */
@@ -70,69 +124,137 @@ void MP2Node::updateRing() {
 	 */
 	// Run stabilization protocol if the hash table size is greater than zero and if there has been a changed in the ring
 	if (change) {
-        stabilizationProtocol();
+        // keep the old placement to tell which ranges moved
+        vector<uint64_t> oldHashes;
+        vector<vector<Node> > oldLists;
+        oldHashes.swap(ringHashes);
+        oldLists.swap(preferenceLists);
+        indexRing();
+        stabilizationProtocol(oldHashes, oldLists);
 	}
 
-	// Also update the transaction map to see if any has been successful or failed
+	// Also fail the transactions that have timed out
 	updateTransactionMap();
 }
 
+/**
+ * FUNCTION NAME: updateTransactionMap
+ *
+ * DESCRIPTION: Close the transactions that timed out, failing those not settled yet. Each is put
+ * 				on txTimeouts when it starts, so only the timers due this tick are visited; a
+ * 				transaction closed on a reply has left its slot by then, and its timer is skipped.
+ * 				Hedged reads still short of a quorum after HEDGE_DELAY ask their held back replicas.
+ */
 void MP2Node::updateTransactionMap() {
-    if (txMap.empty()) { // nothing to check here
-        return;
+    hedges->advance(par->getcurrtime(), [&](const string &id, int) {
+        Transaction *transaction = findTransaction(stoi(id));
+        if (transaction != NULL && !transaction->settled && transaction->hedgePending()) {
+            fireHedge(*transaction);
+        }
+    });
+    txTimeouts->advance(par->getcurrtime(), [&](const string &id, int) {
+        Transaction *transaction = findTransaction(stoi(id));
+        if (transaction != NULL) {
+            closeTransaction(*transaction);
+        }
+    });
+}
+
+/**
+ * FUNCTION NAME: trackTransaction
+ *
+ * DESCRIPTION: Open a client transaction in its slot, timing out OPERATION_TIMEOUT ticks from
+ * 				now. A transaction TRANSACTION_SLOTS ids older still in the slot is closed first,
+ * 				so a coordinator never holds more than TRANSACTION_SLOTS transactions.
+ */
+void MP2Node::trackTransaction(const Transaction &transaction) {
+    Transaction &slot = txSlots[transaction.txId % TRANSACTION_SLOTS];
+    if (slot.txId >= 0) {
+        closeTransaction(slot);
     }
-    // Go through each entry in the transaction map
-    for (auto it = txMap.begin(); it != txMap.end();) {
-        int txId = it->first;
-        Transaction *transaction = &it->second;
-
-        // if this transaction has enough successful replies, log success
-        if (transaction->successCount >= QUORUM) { // operation successful! log success as coordinator
-            switch (transaction->type) {
-                case READ:
-                    log->logReadSuccess(&memberNode->addr, true, txId, transaction->key, transaction->value);
-                    break;
-                case UPDATE:
-                    log->logUpdateSuccess(&memberNode->addr, true, txId, transaction->key, transaction->value);
-                    break;
-                case CREATE:
-                    log->logCreateSuccess(&memberNode->addr, true, txId, transaction->key, transaction->value);
-                    break;
-                case DELETE:
-                    log->logDeleteSuccess(&memberNode->addr, true, txId, transaction->key);
-                    break;
-                default:
-                    break;
-            }
-            txMap.erase(it++);
-            continue;
+    slot = transaction;
+    txTimeouts->schedule(to_string(transaction.txId), transaction.timestamp + OPERATION_TIMEOUT + 1);
+}
+
+/**
+ * FUNCTION NAME: findTransaction
+ *
+ * DESCRIPTION: The open transaction with the id. Its slot is a single index away; a slot
+ * 				that is free or reused by a later transaction means the one asked for is settled.
+ *
+ * RETURNS:
+ * the transaction, NULL if it is no longer open
+ */
+Transaction *MP2Node::findTransaction(int txId) {
+    if (txId < 0) {
+        return NULL;
+    }
+    Transaction &slot = txSlots[txId % TRANSACTION_SLOTS];
+    return slot.txId == txId ? &slot : NULL;
+}
+
+/**
+ * FUNCTION NAME: finishTransaction
+ *
+ * DESCRIPTION: Log the outcome of a transaction as coordinator, settling it
+ */
+void MP2Node::finishTransaction(Transaction &transaction, bool success) {
+    int txId = transaction.txId;
+    if (success) { // operation successful! log success as coordinator
+        opLatencies[min(par->getcurrtime() - transaction.timestamp, (int)opLatencies.size() - 1)]++;
+        switch (transaction.type) {
+            case READ:
+                log->logReadSuccess(&memberNode->addr, true, txId, transaction.key, transaction.value);
+                break;
+            case UPDATE:
+                log->logUpdateSuccess(&memberNode->addr, true, txId, transaction.key, transaction.value);
+                break;
+            case CREATE:
+                log->logCreateSuccess(&memberNode->addr, true, txId, transaction.key, transaction.value);
+                break;
+            case DELETE:
+                log->logDeleteSuccess(&memberNode->addr, true, txId, transaction.key);
+                break;
+            default:
+                break;
         }
-        // This transaction DOES NOT have enough success replies...
-        // So we check if it has reached maximum replies, or it has timed out
-        if (transaction->totalCount == TOTAL || par->getcurrtime() - transaction->timestamp > OPERATION_TIMEOUT) { // operation failed :( log failure as coordinator
-            switch (transaction->type) {
-                case READ:
-                    log->logReadFail(&memberNode->addr, true, txId, transaction->key);
-                    break;
-                case UPDATE:
-                    log->logUpdateFail(&memberNode->addr, true, txId, transaction->key, transaction->value);
-                    break;
-                case CREATE:
-                    log->logCreateFail(&memberNode->addr, true, txId, transaction->key, transaction->value);
-                    break;
-                case DELETE:
-                    log->logDeleteFail(&memberNode->addr, true, txId, transaction->key);
-                    break;
-                default:
-                    break;
-            }
-            txMap.erase(it++);
-            continue;
+    } else { // operation failed :( log failure as coordinator
+        opFailures++;
+        switch (transaction.type) {
+            case READ:
+                log->logReadFail(&memberNode->addr, true, txId, transaction.key);
+                break;
+            case UPDATE:
+                log->logUpdateFail(&memberNode->addr, true, txId, transaction.key, transaction.value);
+                break;
+            case CREATE:
+                log->logCreateFail(&memberNode->addr, true, txId, transaction.key, transaction.value);
+                break;
+            case DELETE:
+                log->logDeleteFail(&memberNode->addr, true, txId, transaction.key);
+                break;
+            default:
+                break;
         }
-        // otherwise, we don't do anything
-        // since if transaction doesn't exist in the map, it's already resolved
-        it++;
     }
+    transaction.settled = true;
+}
+
+/**
+ * FUNCTION NAME: closeTransaction
+ *
+ * DESCRIPTION: Stop listening for replies to a transaction and free its slot. One not settled yet
+ * 				has failed; a read that succeeded repairs the replicas that answered with an older copy.
+ */
+void MP2Node::closeTransaction(Transaction &transaction) {
+    if (!transaction.settled) {
+        finishTransaction(transaction, false);
+    }
+    if (transaction.type == READ && transaction.successCount >= transaction.required) {
+        repairRead(transaction);
+    }
+    // the slot is free for the next transaction
+    transaction.txId = -1;
 }
 
 /**
@@ -164,14 +286,13 @@ vector<Node> MP2Node::getMembershipList() {
 *
 * DESCRIPTION: This functions hashes the key and returns the position on the ring
 *                 HASH FUNCTION USED FOR CONSISTENT HASHING
+*                 hash64 is fixed, so keys keep their positions across builds and platforms
 *
 * RETURNS:
-* size_t position on the ring
+* uint64_t position on the ring
 */
-size_t MP2Node::hashFunction(string key) {
-	std::hash<string> hashFunc;
-	size_t ret = hashFunc(key);
-	return ret%RING_SIZE;
+uint64_t MP2Node::hashFunction(const string &key) {
+	return hash64(key.data(), key.size());
 }
 
 /**
@@ -182,22 +303,26 @@ size_t MP2Node::hashFunction(string key) {
 *                 1) Constructs the message
 *                 2) Finds the replicas of this key
 *                 3) Sends a message to the replica
+*                 A positive ttl makes the key expire that many ticks after each replica stores it.
+*                 Every replica is sent the key; level sets how many must store it for success.
 */
-void MP2Node::clientCreate(string key, string value) {
+void MP2Node::clientCreate(string key, string value, int ttl, ConsistencyLevel level) {
     // start a transaction
-    Transaction transaction(CREATE, par->getcurrtime());
+    Transaction transaction(CREATE, par->getcurrtime(), requiredReplies(CREATE, level));
     transaction.key = key;
     transaction.value = value;
-    txMap.emplace(transaction.txId, transaction);
+    trackTransaction(transaction);
 
     // send messages to all nodes who should hold the key
-    auto nodes = findNodes(key);
+    const vector<Node> &nodes = preferenceList(key);
     int txId = transaction.txId;
+    vector<Address> standIns;
     for (int i = 0; i < nodes.size(); i++) {
         auto node = nodes[i];
         Message msg(txId, memberNode->addr, CREATE, key, value);
         msg.replica = static_cast<ReplicaType>(i);
-        sendMessage(node.nodeAddress, msg);
+        msg.ttl = ttl;
+        sendWrite(node.nodeAddress, msg, &standIns);
     }
 }
 
@@ -210,16 +335,34 @@ void MP2Node::clientCreate(string key, string value) {
 *                 2) Finds the replicas of this key
 *                 3) Sends a message to the replica
 */
-void MP2Node::clientRead(string key){
+void MP2Node::clientRead(string key, ConsistencyLevel level){
     // start a transaction
-    Transaction transaction(READ, par->getcurrtime());
+    Transaction transaction(READ, par->getcurrtime(), requiredReplies(READ, level));
     transaction.key = key;
-    txMap.emplace(transaction.txId, transaction);
+    trackTransaction(transaction);
 
     // send messages to all nodes who should hold the key
-    auto nodes = findNodes(key);
+    const vector<Node> &nodes = preferenceList(key);
     int txId = transaction.txId;
+    // a hedged read asks only as many replicas as it needs, the fastest to answer so far, and
+    // holds back the rest unless it needs them all
+    vector<int> order;
     for (int i = 0; i < nodes.size(); i++) {
+        order.push_back(i);
+    }
+    int replicas = par->REPLICATION_FACTOR;
+    if (par->HEDGE_DELAY > 0 && nodes.size() == (size_t)replicas && transaction.required < replicas) {
+        stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return replyTimes[nodes[a].nodeAddress.getAddress()] < replyTimes[nodes[b].nodeAddress.getAddress()];
+        });
+        Transaction *open = findTransaction(txId);
+        for (size_t i = transaction.required; i < order.size(); i++) {
+            open->hedgeReplicas.emplace_back(order[i], nodes[order[i]].nodeAddress);
+        }
+        order.resize(transaction.required);
+        hedges->schedule(to_string(txId), transaction.timestamp + par->HEDGE_DELAY);
+    }
+    for (int i : order) {
         auto node = nodes[i];
         Message msg(txId, memberNode->addr, READ, key);
         msg.replica = static_cast<ReplicaType>(i);
@@ -235,22 +378,25 @@ void MP2Node::clientRead(string key){
 *                 1) Constructs the message
 *                 2) Finds the replicas of this key
 *                 3) Sends a message to the replica
+*                 The update replaces the time to live of the key: ttl, or none if it is 0.
 */
-void MP2Node::clientUpdate(string key, string value){
+void MP2Node::clientUpdate(string key, string value, int ttl, ConsistencyLevel level){
     // start a transaction
-    Transaction transaction(UPDATE, par->getcurrtime());
+    Transaction transaction(UPDATE, par->getcurrtime(), requiredReplies(UPDATE, level));
     transaction.key = key;
     transaction.value = value;
-    txMap.emplace(transaction.txId, transaction);
+    trackTransaction(transaction);
 
     // send messages to all nodes who should hold the key
-    auto nodes = findNodes(key);
+    const vector<Node> &nodes = preferenceList(key);
     int txId = transaction.txId;
+    vector<Address> standIns;
     for (int i = 0; i < nodes.size(); i++) {
         auto node = nodes[i];
         Message msg(txId, memberNode->addr, UPDATE, key, value);
         msg.replica = static_cast<ReplicaType>(i);
-        sendMessage(node.nodeAddress, msg);
+        msg.ttl = ttl;
+        sendWrite(node.nodeAddress, msg, &standIns);
     }
 }
 
@@ -263,14 +409,14 @@ void MP2Node::clientUpdate(string key, string value){
 *                 2) Finds the replicas of this key
 *                 3) Sends a message to the replica
 */
-void MP2Node::clientDelete(string key){
+void MP2Node::clientDelete(string key, ConsistencyLevel level){
     // start a transaction
-    Transaction transaction(DELETE, par->getcurrtime());
+    Transaction transaction(DELETE, par->getcurrtime(), requiredReplies(DELETE, level));
     transaction.key = key;
-    txMap.emplace(transaction.txId, transaction);
+    trackTransaction(transaction);
 
     // send messages to all nodes who should hold the key
-    auto nodes = findNodes(key);
+    const vector<Node> &nodes = preferenceList(key);
     int txId = transaction.txId;
     for (int i = 0; i < nodes.size(); i++) {
         auto node = nodes[i];
@@ -280,6 +426,28 @@ void MP2Node::clientDelete(string key){
     }
 }
 
+/**
+ * FUNCTION NAME: requiredReplies
+ *
+ * DESCRIPTION: Successful replies a client operation at a consistency level needs. ONE answers
+ * 				with the first replica, QUORUM waits for a majority and ALL for every one. A level
+ * 				other than the default may give up READ_QUORUM + WRITE_QUORUM > REPLICATION_FACTOR
+ * 				for that operation, so a
+ * 				read at ONE can miss a write acknowledged by WRITE_QUORUM replicas.
+ */
+int MP2Node::requiredReplies(MessageType type, ConsistencyLevel level) {
+	switch ( level ) {
+		case CL_ONE:
+			return 1;
+		case CL_QUORUM:
+			return par->REPLICATION_FACTOR / 2 + 1;
+		case CL_ALL:
+			return par->REPLICATION_FACTOR;
+		default:
+			return type == READ ? par->READ_QUORUM : par->WRITE_QUORUM;
+	}
+}
+
 /**
 * FUNCTION NAME: createKeyValue
 *
@@ -288,11 +456,33 @@ void MP2Node::clientDelete(string key){
 *                    1) Inserts key value into the local hash table
 *                    2) Return true or false based on success or failure
 */
-bool MP2Node::createKeyValue(string key, string value, ReplicaType replica) {
+bool MP2Node::createKeyValue(string key, string value, ReplicaType replica, int ttl) {
 	// Insert key, value, replicaType into the hash table
-	Entry entry(value, this->par->getcurrtime(), replica);
-	auto res = ht->create(key, entry.convertToString());
-	return res;
+	int expiresAt = ttl > 0 ? par->getcurrtime() + ttl : 0;
+	Entry entry(value, this->par->getcurrtime(), replica, expiresAt);
+	return createEntry(key, entry);
+}
+
+/**
+ * FUNCTION NAME: createEntry
+ *
+ * DESCRIPTION: Insert an entry as it is, with its timestamp and expiry time, logging it to the
+ * 				WAL and scheduling its expiry. A tombstone of the key is dropped.
+ */
+bool MP2Node::createEntry(const string &key, const Entry &entry) {
+	if ( !ht->create(key, entry) ) {
+		return false;
+	}
+	// the write is newer than any delete of the key seen here (see mergeEntry)
+	tombstones.erase(key);
+	if ( wal != NULL ) {
+		wal->append(WAL_CREATE, key, entry.encode());
+	}
+	if ( entry.expiresAt != 0 ) {
+		expiries->schedule(key, entry.expiresAt);
+	}
+	evictOverBudget();
+	return true;
 }
 
 /**
@@ -305,14 +495,29 @@ bool MP2Node::createKeyValue(string key, string value, ReplicaType replica) {
 */
 string MP2Node::readKey(string key) {
 	// Read key from local hash table and return value
-	auto val = ht->read(key);
-	if (val.empty()) {
-	    return val;
+	Entry entry;
+	if (!readEntry(key, &entry)) {
+	    return "";
 	}
-	Entry entry(val);
 	return entry.value;
 }
 
+/**
+ * FUNCTION NAME: readEntry
+ *
+ * DESCRIPTION: Read the stored entry of a key, counting the hit or miss and marking the key
+ * 				recently used
+ */
+bool MP2Node::readEntry(const string &key, Entry *entry) {
+	if ( !ht->read(key, entry) ) {
+		readMisses++;
+		return false;
+	}
+	readHits++;
+	ht->touch(key);
+	return true;
+}
+
 /**
 * FUNCTION NAME: updateKeyValue
 *
@@ -321,10 +526,83 @@ string MP2Node::readKey(string key) {
 *                 1) Update the key to the new value in the local hash table
 *                 2) Return true or false based on success or failure
 */
-bool MP2Node::updateKeyValue(string key, string value, ReplicaType replica) {
+bool MP2Node::updateKeyValue(string key, string value, ReplicaType replica, int ttl) {
 	// Update key in local hash table and return true or false
-    Entry entry(value, par->getcurrtime(), replica);
-    return ht->update(key, entry.convertToString());
+    int expiresAt = ttl > 0 ? par->getcurrtime() + ttl : 0;
+    Entry entry(value, par->getcurrtime(), replica, expiresAt);
+    return updateEntry(key, entry);
+}
+
+/**
+ * FUNCTION NAME: updateEntry
+ *
+ * DESCRIPTION: Overwrite a stored key with an entry as it is, logging it to the WAL and
+ * 				scheduling its expiry. A tombstone of the key is dropped.
+ */
+bool MP2Node::updateEntry(const string &key, const Entry &entry) {
+	if ( !ht->update(key, entry) ) {
+		return false;
+	}
+	tombstones.erase(key);
+	if ( wal != NULL ) {
+		wal->append(WAL_UPDATE, key, entry.encode());
+	}
+	if ( entry.expiresAt != 0 ) {
+		expiries->schedule(key, entry.expiresAt);
+	}
+	evictOverBudget();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: newerCopy
+ *
+ * DESCRIPTION: Whether one copy of a key was written after another. A delete wins over a write
+ * 				of the same tick, and writes of the same tick are ordered by value, so every
+ * 				replica and coordinator picks the same one.
+ */
+static bool newerCopy(int timestamp, bool deleted, const string &value, int otherTimestamp, bool otherDeleted,
+		const string &otherValue) {
+	if ( timestamp != otherTimestamp ) {
+		return timestamp > otherTimestamp;
+	}
+	if ( deleted != otherDeleted ) {
+		return deleted;
+	}
+	return value > otherValue;
+}
+
+/**
+ * FUNCTION NAME: mergeEntry
+ *
+ * DESCRIPTION: Store an entry copied from another replica unless the stored copy of the key, or
+ * 				its tombstone, is as new (see newerCopy). A tombstone deletes the stored copy
+ * 				quietly, since this is not a client operation, and is remembered in its place.
+ *
+ * RETURNS:
+ * true if the entry was stored or the key deleted
+ */
+bool MP2Node::mergeEntry(const string &key, const Entry &entry) {
+	Entry current;
+	bool stored = ht->read(key, &current);
+	if ( !stored && !tombstoneOf(key, &current) ) {
+		if ( entry.deleted ) {
+			recordTombstone(key, entry.timestamp);
+			return true;
+		}
+		return createEntry(key, entry);
+	}
+	if ( !newerCopy(entry.timestamp, entry.deleted, entry.value, current.timestamp, current.deleted, current.value) ) {
+		return false;
+	}
+	if ( entry.deleted ) {
+		if ( stored ) {
+			deletekey(key);
+		}
+		recordTombstone(key, entry.timestamp);
+		return true;
+	}
+	return stored ? updateEntry(key, entry) : createEntry(key, entry);
 }
 
 /**
@@ -337,7 +615,107 @@ bool MP2Node::updateKeyValue(string key, string value, ReplicaType replica) {
 */
 bool MP2Node::deletekey(string key) {
 	// Delete the key from the local hash table
-	return ht->deleteKey(key);
+	if ( !ht->deleteKey(key) ) {
+		return false;
+	}
+	if ( wal != NULL ) {
+		wal->append(WAL_DELETE, key, Slice());
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: recordTombstone
+ *
+ * DESCRIPTION: Remember that a key was deleted at a tick, for tombstoneHorizon ticks. Copies of
+ * 				the key written before then are turned away (see mergeEntry), and anti-entropy
+ * 				hands the tombstone to replicas that still hold one.
+ */
+void MP2Node::recordTombstone(const string &key, int deletedAt) {
+	int &tombstone = tombstones.emplace(key, deletedAt).first->second;
+	tombstone = max(tombstone, deletedAt);
+	tombstoneExpiries->schedule(key, tombstone + tombstoneHorizon);
+}
+
+/**
+ * FUNCTION NAME: tombstoneOf
+ *
+ * DESCRIPTION: The tombstone of a key as an entry, to compare with copies of the key or send
+ *
+ * RETURNS:
+ * false if the key has no tombstone
+ */
+bool MP2Node::tombstoneOf(const string &key, Entry *entry) {
+	auto it = tombstones.find(key);
+	if ( it == tombstones.end() ) {
+		return false;
+	}
+	*entry = Entry("", it->second, PRIMARY);
+	entry->deleted = true;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: dropTombstones
+ *
+ * DESCRIPTION: Forget the deletes older than tombstoneHorizon. A replica that has not heard of
+ * 				one by then, say because it was cut off for longer, can bring the key back.
+ */
+void MP2Node::dropTombstones() {
+	tombstoneExpiries->advance(par->getcurrtime(), [&](const string &key, int dropAt) {
+		auto it = tombstones.find(key);
+		if ( it != tombstones.end() && it->second + tombstoneHorizon == dropAt ) {
+			tombstones.erase(it);
+		}
+	});
+}
+
+/**
+ * FUNCTION NAME: reapExpired
+ *
+ * DESCRIPTION: Delete every key whose time to live ran out by now. Only the timers that are due
+ * 				are visited; a timer left behind by a later update or a delete is skipped.
+ */
+void MP2Node::reapExpired() {
+	Entry entry;
+	unsigned long reaped = 0;
+	expiries->advance(par->getcurrtime(), [&](const string &key, int expiresAt) {
+		if ( ht->read(key, &entry) && entry.expiresAt == expiresAt && deletekey(key) ) {
+			reaped++;
+		}
+	});
+	if ( reaped > 0 ) {
+		log->LOG(&memberNode->addr, "TTL: %lu expired keys deleted", reaped);
+	}
+}
+
+/**
+ * FUNCTION NAME: evictOverBudget
+ *
+ * DESCRIPTION: Evict the keys CLOCK picks until ht fits its memory budget again. Every eviction
+ * 				is logged, so misses caused by the budget can be told apart in dbg.log.
+ */
+void MP2Node::evictOverBudget() {
+	string victim;
+	while ( ht->evict(&victim) ) {
+		if ( wal != NULL ) {
+			wal->append(WAL_DELETE, victim, Slice());
+		}
+		log->LOG(&memberNode->addr, "cache: evicted key=%s", victim.c_str());
+	}
+}
+
+/**
+ * FUNCTION NAME: scheduleExpiries
+ *
+ * DESCRIPTION: Set the expiry timers of the keys recovered from disk
+ */
+void MP2Node::scheduleExpiries() {
+	ht->scan([&](const string &key, const Entry &entry) {
+		if ( entry.expiresAt != 0 ) {
+			expiries->schedule(key, entry.expiresAt);
+		}
+	});
 }
 
 /**
@@ -352,6 +730,10 @@ void MP2Node::checkMessages() {
 	char * data;
 	int size;
 
+	// Expired keys go before anything can read them this tick
+	reapExpired();
+	dropTombstones();
+
 	// dequeue all messages and handle them
 	while ( !memberNode->mp2q.empty() ) {
 	    // Pop a message from the queue
@@ -361,6 +743,9 @@ void MP2Node::checkMessages() {
 
 		string strMsg(data, data + size);
 		Message msg(strMsg);
+		if ( par->SLOPPY_QUORUM ) {
+			awaiting.erase(msg.fromAddr.getAddress());
+		}
 
 		// Handle the message types here
         switch (msg.type) {
@@ -380,6 +765,15 @@ void MP2Node::checkMessages() {
             case READREPLY:
                 handleReplyMessage(msg);
                 break;
+            case TRANSFER:
+                handleTransferMessage(msg);
+                break;
+            case TRANSFERACK:
+                handleTransferAckMessage(msg);
+                break;
+            case MERKLE:
+                handleMerkleMessage(msg);
+                break;
             default:
                 break;
         }
@@ -389,6 +783,37 @@ void MP2Node::checkMessages() {
 	* This function should also ensure all READ and UPDATE operation
 	* get QUORUM replies
 	*/
+
+	// Compare Merkle trees with the replicas of my segments now and then
+	if ( antiEntropy && par->getcurrtime() % par->ANTI_ENTROPY_INTERVAL == 0 ) {
+		startAntiEntropy();
+	}
+
+	// Hand held writes to their replicas once they are back
+	if ( !hints.empty() ) {
+		replayHints();
+	}
+
+	// Send the next batches of the bulk transfers, and resend stalled ones
+	pumpTransfers();
+
+	// Group commit: one write and one fsync for everything this tick changed,
+	// before any reply sent this tick can be received
+	if ( wal != NULL && !wal->commit() ) {
+		log->LOG(&memberNode->addr, "WAL: commit to %s failed", wal->getPath().c_str());
+	}
+	if ( !hints.commit() ) {
+		log->LOG(&memberNode->addr, "hints: commit to %s failed", hints.getPath().c_str());
+	}
+
+	if ( par->SNAPSHOT_INTERVAL > 0 && par->getcurrtime() % par->SNAPSHOT_INTERVAL == 0 ) {
+		takeSnapshot();
+	}
+
+	// Periodically give back storage memory freed by deletes and updates
+	if ( par->getcurrtime() % COMPACTION_INTERVAL == 0 ) {
+		ht->compact();
+	}
 }
 
 /**
@@ -398,29 +823,220 @@ void MP2Node::checkMessages() {
 *                 This function is responsible for finding the replicas of a key
 */
 vector<Node> MP2Node::findNodes(string key) {
-	size_t pos = hashFunction(key);
-	vector<Node> addr_vec;
-	if (ring.size() >= 3) {
-		// if pos <= min || pos > max, the leader is the min
-		if (pos <= ring.at(0).getHashCode() || pos > ring.at(ring.size()-1).getHashCode()) {
-			addr_vec.emplace_back(ring.at(0));
-			addr_vec.emplace_back(ring.at(1));
-			addr_vec.emplace_back(ring.at(2));
+	return preferenceList(key);
+}
+
+/**
+ * FUNCTION NAME: preferenceList
+ *
+ * DESCRIPTION: The replicas of the key, in replica order
+ */
+const vector<Node> &MP2Node::preferenceList(const string &key) {
+	return preferenceListAt(hashFunction(key));
+}
+
+/**
+ * FUNCTION NAME: segmentOf
+ *
+ * DESCRIPTION: Index of the first ring position at or after pos; past the last position the
+ * 				ring wraps around to the first
+ */
+static size_t segmentOf(const vector<uint64_t> &hashes, uint64_t pos) {
+	size_t segment = lower_bound(hashes.begin(), hashes.end(), pos) - hashes.begin();
+	return segment == hashes.size() ? 0 : segment;
+}
+
+/**
+ * FUNCTION NAME: indexOfNode
+ *
+ * DESCRIPTION: Position of the member with the address in nodes, -1 if it is not there
+ */
+static long indexOfNode(const vector<Node> &nodes, const Address &address) {
+	for ( size_t i = 0; i < nodes.size(); i++ ) {
+		if ( nodes[i].nodeAddress == address ) {
+			return (long)i;
 		}
-		else {
-			// go through the ring until pos <= node
-			for (int i=1; i < (int)ring.size(); i++){
-				Node addr = ring.at(i);
-				if (pos <= addr.getHashCode()) {
-					addr_vec.emplace_back(addr);
-					addr_vec.emplace_back(ring.at((i+1)%ring.size()));
-					addr_vec.emplace_back(ring.at((i+2)%ring.size()));
-					break;
-				}
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: preferenceListAt
+ *
+ * DESCRIPTION: The replicas of the keys at a ring position: a binary search for the first ring
+ * 				node at or after the position picks the segment, whose list is cached.
+ * 				The reference stays valid until the ring changes.
+ *
+ * RETURNS:
+ * the three replicas, none if the ring has fewer than three nodes
+ */
+const vector<Node> &MP2Node::preferenceListAt(uint64_t pos) {
+	static const vector<Node> none;
+	if ( preferenceLists.empty() ) {
+		return none;
+	}
+	return preferenceLists[segmentOf(ringHashes, pos)];
+}
+
+/**
+ * FUNCTION NAME: heardFrom
+ *
+ * DESCRIPTION: The tick the membership protocol last had a newer heartbeat of a member
+ *
+ * RETURNS:
+ * the tick, -1 if it is not a member
+ */
+long MP2Node::heardFrom(const Address &address) {
+	for ( size_t i = 0; i < memberNode->memberList.size(); i++ ) {
+		MemberListEntry &entry = memberNode->memberList[i];
+		Address member;
+		memcpy(&member.addr[0], &entry.id, sizeof(int));
+		memcpy(&member.addr[4], &entry.port, sizeof(short));
+		if ( member == address ) {
+			return entry.gettimestamp();
+		}
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: isDown
+ *
+ * DESCRIPTION: Whether a member looks down: it has left a request unanswered for SUSPECT_TIMEOUT
+ * 				ticks, and the membership protocol has not had a newer heartbeat of it since, or
+ * 				it is not a member at all. Heartbeats spread by gossip and arrive many ticks
+ * 				apart, so their age alone does not tell a member that is down. Once a newer
+ * 				heartbeat arrives the member counts as back, and the next request tries it again.
+ */
+bool MP2Node::isDown(const Address &address) {
+	auto waiting = awaiting.find(address.getAddress());
+	if ( waiting == awaiting.end() || par->getcurrtime() - waiting->second < SUSPECT_TIMEOUT ) {
+		return false;
+	}
+	if ( heardFrom(address) > waiting->second ) {
+		awaiting.erase(waiting);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: standIn
+ *
+ * DESCRIPTION: The first member clockwise from a key that is up, outside its preference list and
+ * 				not taken already by another replica of the same write
+ *
+ * RETURNS:
+ * the stand-in, a null address if there is none
+ */
+Address MP2Node::standIn(const string &key, const vector<Address> &taken) {
+	const vector<Node> &replicas = preferenceList(key);
+	if ( replicas.empty() ) {
+		return Address();
+	}
+	size_t first = segmentOf(ringHashes, hashFunction(key));
+	for ( size_t step = 0; step < preferenceLists.size(); step++ ) {
+		// the member of virtual node i heads preferenceLists[i]
+		const Address &candidate = preferenceLists[(first + step) % preferenceLists.size()][0].nodeAddress;
+		if ( indexOfNode(replicas, candidate) < 0 && find(taken.begin(), taken.end(), candidate) == taken.end()
+				&& !isDown(candidate) ) {
+			return candidate;
+		}
+	}
+	return Address();
+}
+
+/**
+ * FUNCTION NAME: sendWrite
+ *
+ * DESCRIPTION: Send a create or update to a replica. With SLOPPY_QUORUM, a write for a replica
+ * 				that is down goes to a stand-in instead, with a hint naming the replica; the
+ * 				stand-in's reply counts towards the quorum. A write with no stand-in left goes
+ * 				to the replica anyway.
+ */
+void MP2Node::sendWrite(const Address &replica, Message &msg, vector<Address> *standIns) {
+	if ( par->SLOPPY_QUORUM && isDown(replica) ) {
+		Address to = standIn(msg.key, *standIns);
+		if ( to != Address() ) {
+			msg.hintFor = replica;
+			standIns->push_back(to);
+			sendMessage(to, msg);
+			return;
+		}
+	}
+	sendMessage(replica, msg);
+}
+
+/**
+ * FUNCTION NAME: indexRing
+ *
+ * DESCRIPTION: Rebuild the virtual node positions and the replicas of every segment after the
+ * 				ring changed. Each member places par->VNODES virtual nodes. Segment i belongs to
+ * 				the member of virtual node i and the next distinct members clockwise, so a
+ * 				member's arcs, and its load when it fails, are spread over many successors.
+ * 				Virtual nodes at the same position are ordered by address, so every node builds
+ * 				the same lists from the same members.
+ */
+void MP2Node::indexRing() {
+	ringHashes.clear();
+	preferenceLists.clear();
+	size_t replicas = (size_t)par->REPLICATION_FACTOR;
+	if ( ring.size() < replicas ) {
+		return;
+	}
+	// (position, member) of every virtual node
+	vector<pair<uint64_t, size_t> > tokens;
+	for ( size_t i = 0; i < ring.size(); i++ ) {
+		for ( int vnode = 0; vnode < par->VNODES; vnode++ ) {
+			tokens.emplace_back(ring[i].tokenHashCode(vnode), i);
+		}
+	}
+	sort(tokens.begin(), tokens.end(), [&](const pair<uint64_t, size_t> &a, const pair<uint64_t, size_t> &b) {
+		if ( a.first != b.first ) {
+			return a.first < b.first;
+		}
+		return memcmp(ring[a.second].nodeAddress.addr, ring[b.second].nodeAddress.addr, sizeof(ring[a.second].nodeAddress.addr)) < 0;
+	});
+	vector<bool> chosen(ring.size(), false);
+	for ( size_t t = 0; t < tokens.size(); t++ ) {
+		ringHashes.push_back(tokens[t].first);
+		vector<size_t> members;
+		for ( size_t step = 0; members.size() < replicas; step++ ) {
+			size_t member = tokens[(t + step) % tokens.size()].second;
+			if ( !chosen[member] ) {
+				chosen[member] = true;
+				members.push_back(member);
+			}
+		}
+		vector<Node> list;
+		for ( size_t k = 0; k < members.size(); k++ ) {
+			chosen[members[k]] = false;
+			list.push_back(ring[members[k]]);
+		}
+		preferenceLists.push_back(list);
+	}
+
+	hasMyReplicas.clear();
+	haveReplicasOf.clear();
+	auto add = [](vector<Node> &nodes, const Node &node) {
+		if ( indexOfNode(nodes, node.nodeAddress) < 0 ) {
+			nodes.push_back(node);
+		}
+	};
+	for ( size_t i = 0; i < preferenceLists.size(); i++ ) {
+		const vector<Node> &replicas = preferenceLists[i];
+		if ( replicas[0].nodeAddress == memberNode->addr ) {
+			for ( size_t k = 1; k < replicas.size(); k++ ) {
+				add(hasMyReplicas, replicas[k]);
 			}
 		}
+		else if ( indexOfNode(replicas, memberNode->addr) >= 0 ) {
+			add(haveReplicasOf, replicas[0]);
+		}
+	}
+	if ( antiEntropy ) {
+		ht->setMerkleRanges(ringHashes);
 	}
-	return addr_vec;
 }
 
 /**
@@ -456,28 +1072,772 @@ int MP2Node::enqueueWrapper(void *env, char *buff, int size) {
 *                1) Ensures that there are three "CORRECT" replicas of all the keys in spite of failures and joins
 *                Note:- "CORRECT" replicas implies that every key is replicated in its two neighboring nodes in the ring.
  *
- *                We only want to replicate primary copies for each node
+ *                Only the keys of ring ranges whose replicas changed are copied, and only to the
+ *                replicas that are new to the range (see planTransfers). Keys of a range this node
+ *                still holds at another position are re-tagged in place with the new replica type.
  *
 */
-void MP2Node::stabilizationProtocol() {
-    for (auto pair : ht->hashTable) {
-        auto nodes = findNodes(pair.first);
-        for (auto node : nodes) {
-            Message msg(-1, memberNode->addr, CREATE, pair.first, pair.second);
-            sendMessage(*node.getAddress(), msg);
-        }
+void MP2Node::stabilizationProtocol(const vector<uint64_t> &oldHashes, const vector<vector<Node> > &oldLists) {
+    vector<uint64_t> ranges;
+    vector<int> retags;
+    auto transfers = planTransfers(oldHashes, oldLists, &ranges, &retags);
+    if (transfers.empty()) {
+        return;
+    }
+    int now = par->getcurrtime();
+    // keys for each (replica, replica type), streamed in bulk once they are all sorted out
+    map<pair<string, int>, pair<Address, vector<string> > > streams;
+    // keys stored as another replica type than their new one; ht cannot change during the scan
+    vector<pair<string, int> > moved;
+    // keys are placed a batch at a time so their hashes are computed together
+    vector<string> pending;
+    vector<int> pendingTypes;
+    vector<Slice> keys;
+    uint64_t hashes[STABILIZATION_BATCH];
+    auto flush = [&]() {
+        keys.clear();
+        for (size_t j = 0; j < pending.size(); j++) {
+            keys.push_back(Slice(pending[j]));
+        }
+        hash64Batch(keys.data(), keys.size(), hashes);
+        for (size_t j = 0; j < pending.size(); j++) {
+            size_t range = lower_bound(ranges.begin(), ranges.end(), hashes[j]) - ranges.begin();
+            if (range == ranges.size()) {
+                range = 0;
+            }
+            if (retags[range] >= 0 && retags[range] != pendingTypes[j]) {
+                moved.emplace_back(pending[j], retags[range]);
+            }
+            const auto &targets = transfers[range];
+            for (size_t i = 0; i < targets.size(); i++) {
+                auto &stream = streams[make_pair(targets[i].first.getAddress(), (int)targets[i].second)];
+                stream.first = targets[i].first;
+                stream.second.push_back(pending[j]);
+            }
+        }
+        pending.clear();
+        pendingTypes.clear();
+    };
+    ht->scan([&](const string &key, const Entry &entry) {
+        // an expired key is about to be reaped, not copied
+        if (entry.isExpired(now)) {
+            return;
+        }
+        pending.push_back(key);
+        pendingTypes.push_back((int)entry.replica);
+        if (pending.size() == STABILIZATION_BATCH) {
+            flush();
+        }
+    });
+    flush();
+    Entry entry;
+    for (size_t i = 0; i < moved.size(); i++) {
+        if (ht->read(moved[i].first, &entry)) {
+            entry.replica = static_cast<ReplicaType>(moved[i].second);
+            updateEntry(moved[i].first, entry);
+        }
+    }
+    for (auto it = streams.begin(); it != streams.end(); it++) {
+        startTransfer(it->second.first, static_cast<ReplicaType>(it->first.second), it->second.second);
+    }
+}
+
+/**
+ * FUNCTION NAME: planTransfers
+ *
+ * DESCRIPTION: Diff the old placement against the current one. The old and new ring positions
+ * 				together cut the ring into ranges that each map to one old and one new replica
+ * 				list; ranges[r] is the end of range r, which holds the keys hashing to
+ * 				(ranges[r-1], ranges[r]], the first one wrapping around the top.
+ * 				A range whose replicas changed is sent to its new replicas that were not old
+ * 				ones by every old replica still on the ring, so a key one of them missed still
+ * 				reaches the new replicas from another; the copies are merged on arrival. If no
+ * 				old replica is left, or the range had none, every holder sends.
+ * 				retags[r] is this node's new position in a changed range r it stays a replica
+ * 				of, -1 otherwise: a replica that moves, say from SECONDARY to PRIMARY, already
+ * 				has the keys and only re-tags its own copies, so no stream goes to it.
+ *
+ * RETURNS:
+ * for each range, the (replica, replica type) pairs this node sends its keys of the range to;
+ * nothing at all if this node has nothing to send or re-tag
+ */
+vector<vector<pair<Address, ReplicaType> > > MP2Node::planTransfers(const vector<uint64_t> &oldHashes,
+		const vector<vector<Node> > &oldLists, vector<uint64_t> *ranges, vector<int> *retags) {
+	vector<vector<pair<Address, ReplicaType> > > transfers;
+	if ( preferenceLists.empty() ) {
+		return transfers;
+	}
+	ranges->assign(oldHashes.begin(), oldHashes.end());
+	ranges->insert(ranges->end(), ringHashes.begin(), ringHashes.end());
+	sort(ranges->begin(), ranges->end());
+	ranges->erase(unique(ranges->begin(), ranges->end()), ranges->end());
+
+	static const vector<Node> none;
+	bool any = false;
+	transfers.resize(ranges->size());
+	retags->assign(ranges->size(), -1);
+	for ( size_t r = 0; r < ranges->size(); r++ ) {
+		const vector<Node> &after = preferenceListAt((*ranges)[r]);
+		const vector<Node> &before = oldLists.empty() ? none : oldLists[segmentOf(oldHashes, (*ranges)[r])];
+		long was = indexOfNode(before, memberNode->addr);
+		long is = indexOfNode(after, memberNode->addr);
+		if ( is >= 0 && is != was ) {
+			(*retags)[r] = (int)is;
+			any = true;
+		}
+		// old replicas still on the ring send; every holder if there is none
+		bool sender = was >= 0;
+		if ( !sender ) {
+			sender = true;
+			for ( size_t i = 0; i < before.size() && sender; i++ ) {
+				sender = indexOfNode(ring, before[i].nodeAddress) < 0;
+			}
+		}
+		if ( !sender ) {
+			continue;
+		}
+		for ( size_t i = 0; i < after.size(); i++ ) {
+			if ( indexOfNode(before, after[i].nodeAddress) < 0 && !(after[i].nodeAddress == memberNode->addr) ) {
+				transfers[r].emplace_back(after[i].nodeAddress, static_cast<ReplicaType>(i));
+				any = true;
+			}
+		}
+	}
+	if ( !any ) {
+		transfers.clear();
+	}
+	return transfers;
+}
+
+/**
+ * FUNCTION NAME: startTransfer
+ *
+ * DESCRIPTION: Open a bulk transfer of keys to a replica, which stores them as the given replica
+ * 				type. keys is taken over. The first batches go out with the next pumpTransfers().
+ */
+void MP2Node::startTransfer(const Address &to, ReplicaType replica, vector<string> &keys, vector<string> *records) {
+	OutgoingTransfer &stream = outgoing[nextStreamId++];
+	streamsOpened++;
+	stream.to = to;
+	stream.replica = replica;
+	stream.keys.swap(keys);
+	if ( records != NULL ) {
+		stream.records.swap(*records);
+	}
+	stream.acked = 0;
+	stream.sent = 0;
+	stream.lastProgress = par->getcurrtime();
+	stream.retries = 0;
+}
+
+/**
+ * FUNCTION NAME: pumpTransfers
+ *
+ * DESCRIPTION: Keep TRANSFER_WINDOW batches of every outgoing stream in flight. A stream with no
+ * 				acknowledged progress for TRANSFER_TIMEOUT ticks resumes from its last
+ * 				acknowledged offset, and is abandoned after TRANSFER_MAX_RETRIES such resends;
+ * 				the next ring change plans it again if the replica is still there, and the hints
+ * 				of a hinted handoff stream go back to the hint log.
+ * 				Receiving state of streams gone quiet is dropped.
+ */
+void MP2Node::pumpTransfers() {
+	int now = par->getcurrtime();
+	for ( auto it = outgoing.begin(); it != outgoing.end(); ) {
+		OutgoingTransfer &stream = it->second;
+		if ( stream.sent > stream.acked && now - stream.lastProgress > TRANSFER_TIMEOUT ) {
+			if ( ++stream.retries > TRANSFER_MAX_RETRIES ) {
+				log->LOG(&memberNode->addr, "transfer: stream %d to %s abandoned at %lu of %lu keys", it->first,
+						stream.to.getAddress().c_str(), (unsigned long)stream.acked, (unsigned long)stream.keys.size());
+				// hints that did not get through are held again, to replay once the replica is back
+				for ( size_t i = stream.acked; i < stream.records.size(); i++ ) {
+					hints.add(stream.to, stream.keys[i], stream.records[i], now);
+					hintsReplayed--;
+				}
+				outgoing.erase(it++);
+				streamsAbandoned++;
+				continue;
+			}
+			stream.sent = stream.acked;
+			stream.batchEnds.clear();
+			stream.lastProgress = now;
+		}
+		while ( stream.batchEnds.size() < TRANSFER_WINDOW && stream.sent < stream.keys.size() ) {
+			sendTransferBatch(it->first, stream);
+		}
+		it++;
+	}
+	for ( auto it = incoming.begin(); it != incoming.end(); ) {
+		if ( now - it->second.lastActive > TRANSFER_IDLE_TIMEOUT ) {
+			incoming.erase(it++);
+		}
+		else {
+			it++;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: sendTransferBatch
+ *
+ * DESCRIPTION: Send the records of the stream from its sent offset, as many as fit in one
+ * 				message. A key deleted here is sent as its tombstone; keys since expired or
+ * 				gone without one are skipped but still counted, so the batch may be empty.
+ * 				A record too large for any message is skipped and logged.
+ */
+void MP2Node::sendTransferBatch(int id, OutgoingTransfer &stream) {
+	size_t budget = par->MAX_MSG_SIZE - sizeof(en_msg) - TRANSFER_HEADER_BYTES;
+	int now = par->getcurrtime();
+	string payload;
+	size_t position = stream.sent;
+	Entry entry;
+	for ( ; position < stream.keys.size(); position++ ) {
+		const string &key = stream.keys[position];
+		string record;
+		if ( !stream.records.empty() ) {
+			record = stream.records[position];
+		}
+		else if ( ht->read(key, &entry) && !entry.isExpired(now) ) {
+			record = entry.encode();
+		}
+		else if ( tombstoneOf(key, &entry) ) {
+			record = entry.encode();
+		}
+		else {
+			continue;
+		}
+		size_t need = TRANSFER_RECORD_PREFIX + key.size() + record.size();
+		if ( need > budget ) {
+			log->LOG(&memberNode->addr, "transfer: key=%s too large to transfer", key.c_str());
+			continue;
+		}
+		if ( payload.size() + need > budget ) {
+			break;
+		}
+		appendTransferRecord(&payload, (uint32_t)position, key, record);
+	}
+	Message msg(id, memberNode->addr, stream.replica, (int)stream.sent, (int)position, payload);
+	sendMessage(stream.to, msg);
+	stream.sent = position;
+	stream.batchEnds.push_back(position);
+}
+
+/**
+ * FUNCTION NAME: handleTransferMessage
+ *
+ * DESCRIPTION: Store the keys of a transfer batch as the replica type of the stream, keeping
+ * 				their timestamps and expiry times, and acknowledge the stream. A key stored here
+ * 				already keeps whichever copy was written last. Nothing is logged per key: this
+ * 				is not a client operation. A batch with TRANSFER_UNACKED_ID belongs to no stream
+ * 				and is only merged.
+ */
+void MP2Node::handleTransferMessage(Message msg) {
+	Entry entry;
+	auto merge = [&](uint32_t, const Slice &key, const Slice &record) {
+		if ( entry.decode(record) && !entry.isExpired(par->getcurrtime()) ) {
+			entry.replica = msg.replica;
+			mergeEntry(key.toString(), entry);
+		}
+	};
+	if ( msg.transID == TRANSFER_UNACKED_ID ) {
+		decodeTransferBatch(msg.value, merge);
+		return;
+	}
+	IncomingTransfer &stream = incoming[make_pair(msg.fromAddr.getAddress(), msg.transID)];
+	stream.lastActive = par->getcurrtime();
+	bool whole = decodeTransferBatch(msg.value, merge);
+	// a damaged batch is not acknowledged, so it is sent again
+	if ( whole ) {
+		stream.arrived(msg.offset, msg.end);
+		recordsReceived += (unsigned long)(msg.end - msg.offset);
+	}
+	Message ack(msg.transID, memberNode->addr, (int)stream.next);
+	sendMessage(msg.fromAddr, ack);
+}
+
+/**
+ * FUNCTION NAME: handleTransferAckMessage
+ *
+ * DESCRIPTION: Move an outgoing stream past everything the receiver has, closing it once all
+ * 				its keys are acknowledged
+ */
+void MP2Node::handleTransferAckMessage(Message msg) {
+	auto it = outgoing.find(msg.transID);
+	if ( it == outgoing.end() ) {
+		return;
+	}
+	OutgoingTransfer &stream = it->second;
+	size_t offset = (size_t)msg.offset;
+	if ( offset > stream.acked ) {
+		stream.acked = min(offset, stream.keys.size());
+		stream.lastProgress = par->getcurrtime();
+		stream.retries = 0;
+		while ( !stream.batchEnds.empty() && stream.batchEnds.front() <= stream.acked ) {
+			stream.batchEnds.pop_front();
+		}
+		// a resend started before this ack arrived carries on from here
+		stream.sent = max(stream.sent, stream.acked);
+	}
+	if ( stream.acked == stream.keys.size() ) {
+		outgoing.erase(it);
+		streamsCompleted++;
+	}
+}
+
+/**
+ * FUNCTION NAME: startAntiEntropy
+ *
+ * DESCRIPTION: Send the root digest of every segment I am the primary of to its other replicas.
+ * 				A replica with the same keys and values has the same root and does not answer,
+ * 				so agreeing replicas cost one message each per round.
+ */
+void MP2Node::startAntiEntropy() {
+	const MerkleTree &trees = ht->getMerkleTree();
+	if ( trees.ranges() != preferenceLists.size() ) {
+		return;
+	}
+	merkleRounds++;
+	map<string, pair<Address, vector<MerkleDigest> > > roots;
+	for ( size_t i = 0; i < preferenceLists.size(); i++ ) {
+		const vector<Node> &replicas = preferenceLists[i];
+		if ( !(replicas[0].nodeAddress == memberNode->addr) ) {
+			continue;
+		}
+		MerkleDigest root = {trees.startOf(i), trees.endOf(i), 1, trees.digest(i, 1)};
+		for ( size_t k = 1; k < replicas.size(); k++ ) {
+			auto &peer = roots[replicas[k].nodeAddress.getAddress()];
+			peer.first = replicas[k].nodeAddress;
+			peer.second.push_back(root);
+		}
+	}
+	for ( auto it = roots.begin(); it != roots.end(); it++ ) {
+		sendMerkleDigests(it->second.first, it->second.second, false);
+	}
+}
+
+/**
+ * FUNCTION NAME: sendMerkleDigests
+ *
+ * DESCRIPTION: Send digests to a replica, as many to a message as fit
+ */
+void MP2Node::sendMerkleDigests(const Address &to, const vector<MerkleDigest> &digests, bool final) {
+	size_t perMessage = (par->MAX_MSG_SIZE - sizeof(en_msg) - MERKLE_HEADER_BYTES) / MERKLE_DIGEST_BYTES;
+	string payload;
+	for ( size_t i = 0; i < digests.size(); i++ ) {
+		appendMerkleDigest(&payload, digests[i]);
+		if ( (i + 1) % perMessage == 0 || i + 1 == digests.size() ) {
+			Message msg(0, memberNode->addr, final, payload);
+			sendMessage(to, msg);
+			payload.clear();
+		}
+	}
+	merkleDigestsSent += digests.size();
+}
+
+/**
+ * FUNCTION NAME: handleMerkleMessage
+ *
+ * DESCRIPTION: Compare a replica's digests with my trees. Matching nodes end the descent there.
+ * 				Of a differing inner node I send back the digests of both children, so the two
+ * 				sides take turns walking down only the subtrees that differ. At a differing
+ * 				leaf I ship my keys of the leaf to the replica and, unless the digests were
+ * 				already an answer, send my digest back so it ships its keys of the leaf too.
+ * 				The stored copy written last wins on both sides (see mergeEntry).
+ * 				Digests of segments that my view of the ring places differently are ignored;
+ * 				a later round compares them once the views agree.
+ */
+void MP2Node::handleMerkleMessage(Message msg) {
+	vector<MerkleDigest> digests;
+	const MerkleTree &trees = ht->getMerkleTree();
+	if ( !decodeMerkleDigests(msg.value, &digests) || trees.ranges() != preferenceLists.size() ) {
+		return;
+	}
+	bool final = msg.offset != 0;
+	vector<MerkleDigest> children;
+	vector<MerkleDigest> answers;
+	set<pair<size_t, size_t> > leaves;
+	for ( size_t i = 0; i < digests.size(); i++ ) {
+		MerkleDigest &theirs = digests[i];
+		long range = trees.findRange(theirs.start, theirs.end);
+		if ( range < 0 || indexOfNode(preferenceLists[range], memberNode->addr) < 0
+				|| indexOfNode(preferenceLists[range], msg.fromAddr) < 0 ) {
+			continue;
+		}
+		if ( trees.digest(range, theirs.node) == theirs.digest ) {
+			continue;
+		}
+		if ( theirs.node < MERKLE_LEAVES ) {
+			for ( uint32_t child = 2 * theirs.node; child <= 2 * theirs.node + 1; child++ ) {
+				MerkleDigest mine = {theirs.start, theirs.end, child, trees.digest(range, child)};
+				children.push_back(mine);
+			}
+			continue;
+		}
+		leaves.insert(make_pair((size_t)range, (size_t)theirs.node));
+		if ( !final ) {
+			MerkleDigest mine = {theirs.start, theirs.end, theirs.node, trees.digest(range, theirs.node)};
+			answers.push_back(mine);
+		}
+	}
+	sendMerkleDigests(msg.fromAddr, children, false);
+	sendMerkleDigests(msg.fromAddr, answers, true);
+	if ( !leaves.empty() ) {
+		repairLeaves(msg.fromAddr, leaves);
+	}
+}
+
+/**
+ * FUNCTION NAME: repairLeaves
+ *
+ * DESCRIPTION: Stream my keys of the given (segment, leaf) pairs to a replica, stored as its
+ * 				replica type in each segment. The tombstones of the leaves go too: the trees
+ * 				only cover live keys, so a replica that missed a delete differs by the key it
+ * 				still holds, and deletes it once the tombstone arrives.
+ */
+void MP2Node::repairLeaves(const Address &to, const set<pair<size_t, size_t> > &leaves) {
+	const MerkleTree &trees = ht->getMerkleTree();
+	int now = par->getcurrtime();
+	vector<vector<string> > keys(par->REPLICATION_FACTOR);
+	size_t range, leaf;
+	merkleLeavesRepaired += leaves.size();
+	auto add = [&](const string &key) {
+		if ( !trees.locate(key, &range, &leaf) || leaves.count(make_pair(range, leaf)) == 0 ) {
+			return;
+		}
+		long replica = indexOfNode(preferenceLists[range], to);
+		if ( replica >= 0 ) {
+			keys[replica].push_back(key);
+		}
+	};
+	ht->scan([&](const string &key, const Entry &entry) {
+		if ( !entry.isExpired(now) ) {
+			add(key);
+		}
+	});
+	for ( auto it = tombstones.begin(); it != tombstones.end(); it++ ) {
+		add(it->first);
+	}
+	for ( size_t replica = 0; replica < keys.size(); replica++ ) {
+		if ( !keys[replica].empty() ) {
+			startTransfer(to, static_cast<ReplicaType>(replica), keys[replica]);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: storeHint
+ *
+ * DESCRIPTION: Take in a write as the stand-in for a replica that is down. It goes to the hint
+ * 				log rather than ht: this node does not hold the key, so it serves no reads of it
+ * 				and logs no success line, but acknowledges the write for the quorum.
+ */
+void MP2Node::storeHint(Message msg) {
+	int expiresAt = msg.ttl > 0 ? par->getcurrtime() + msg.ttl : 0;
+	Entry entry(msg.value, par->getcurrtime(), msg.replica, expiresAt);
+	hints.add(msg.hintFor, msg.key, entry.encode(), par->getcurrtime());
+	hintsStored++;
+	Message reply(msg.transID, memberNode->addr, REPLY, msg.key, msg.value, msg.replica);
+	reply.success = true;
+	sendMessage(msg.fromAddr, reply);
+}
+
+/**
+ * FUNCTION NAME: replayHints
+ *
+ * DESCRIPTION: Hand the hints of each replica that is back to it, as transfer streams of one per
+ * 				replica type. A replica is back once the membership protocol has a newer
+ * 				heartbeat of it than the last hint held for it. The hints of a replica that has
+ * 				left the ring go to the current replicas of each key instead. Either way they are
+ * 				merged like any transfer (see mergeEntry), so a newer write that reached the
+ * 				replica first wins. A stream that is abandoned holds its hints again (see
+ * 				pumpTransfers), as gossip can bring a heartbeat of a replica after it went down.
+ */
+void MP2Node::replayHints() {
+	if ( preferenceLists.empty() ) {
+		return;
+	}
+	// keys and records by receiver and replica type
+	map<pair<string, int>, pair<vector<string>, vector<string> > > streams;
+	Entry entry;
+	vector<Address> owners = hints.owners();
+	for ( size_t i = 0; i < owners.size(); i++ ) {
+		bool inRing = indexOfNode(ring, owners[i]) >= 0;
+		if ( inRing && heardFrom(owners[i]) <= hints.heldAt(owners[i]) ) {
+			continue;
+		}
+		map<string, string> held = hints.take(owners[i]);
+		hintsReplayed += held.size();
+		for ( auto it = held.begin(); it != held.end(); it++ ) {
+			if ( !entry.decode(Slice(it->second)) ) {
+				continue;
+			}
+			if ( inRing ) {
+				auto &stream = streams[make_pair(owners[i].getAddress(), (int)entry.replica)];
+				stream.first.push_back(it->first);
+				stream.second.push_back(it->second);
+				continue;
+			}
+			const vector<Node> &replicas = preferenceList(it->first);
+			for ( size_t k = 0; k < replicas.size(); k++ ) {
+				if ( replicas[k].nodeAddress == memberNode->addr ) {
+					entry.replica = static_cast<ReplicaType>(k);
+					mergeEntry(it->first, entry);
+					continue;
+				}
+				auto &stream = streams[make_pair(replicas[k].nodeAddress.getAddress(), (int)k)];
+				stream.first.push_back(it->first);
+				stream.second.push_back(it->second);
+			}
+		}
+	}
+	for ( auto it = streams.begin(); it != streams.end(); it++ ) {
+		startTransfer(Address(it->first.first), static_cast<ReplicaType>(it->first.second), it->second.first,
+				&it->second.second);
+	}
+}
+
+/**
+ * FUNCTION NAME: logMemoryFootprint
+ *
+ * DESCRIPTION: Write the memory footprint of the local hash table, how well its Bloom filters
+ * 				turn misses away, and how its memory budget is doing, to stats.log
+ */
+void MP2Node::logMemoryFootprint() {
+	StorageStats stats;
+	ht->getStats(&stats);
+	log->LOG(&memberNode->addr, "#STATSLOG# storage: keys=%lu payload=%lu allocated=%lu reserved=%lu index=%lu slabs=%lu mapped=%lu disk=%lu",
+			stats.keys, stats.payloadBytes, stats.allocatedBytes, stats.reservedBytes, stats.indexBytes, stats.slabs,
+			stats.mappedBytes, stats.diskBytes);
+	unsigned long absent = stats.filterNegatives + stats.filterFalsePositives;
+	log->LOG(&memberNode->addr, "#STATSLOG# bloom: negatives=%lu falsePositives=%lu falsePositiveRate=%.4f",
+			stats.filterNegatives, stats.filterFalsePositives, absent > 0 ? (double)stats.filterFalsePositives / absent : 0.0);
+	if ( par->MEMORY_BUDGET > 0 ) {
+		EvictionStats eviction;
+		ht->getEvictionStats(&eviction);
+		unsigned long reads = readHits + readMisses;
+		log->LOG(&memberNode->addr, "#STATSLOG# cache: budget=%lu used=%lu keys=%lu evictions=%lu hits=%lu misses=%lu hitRate=%.4f",
+				eviction.budgetBytes, eviction.chargedBytes, eviction.keys, eviction.evictions, readHits, readMisses,
+				reads > 0 ? (double)readHits / reads : 0.0);
+	}
+}
+
+/**
+ * FUNCTION NAME: logLoadDistribution
+ *
+ * DESCRIPTION: Write to stats.log how evenly the ring spreads keys. share is the fraction of the
+ * 				ring this node is the primary of; minShare and maxShare are the smallest and
+ * 				largest of all members, as placed by this node's view of the ring.
+ */
+void MP2Node::logLoadDistribution() {
+	// fraction of the ring each member is the primary of
+	map<string, double> owned;
+	for ( size_t i = 0; i < ring.size(); i++ ) {
+		owned[ring[i].nodeAddress.getAddress()] = 0;
+	}
+	for ( size_t t = 0; t < ringHashes.size(); t++ ) {
+		// segment t is (previous position, its position]; unsigned wrap-around takes the first
+		// segment across the top of the token space
+		uint64_t arc = ringHashes[t] - ringHashes[(t + ringHashes.size() - 1) % ringHashes.size()];
+		owned[preferenceLists[t][0].nodeAddress.getAddress()] += arc / 18446744073709551616.0;
+	}
+	double least = owned.empty() ? 0 : 1;
+	double most = 0;
+	for ( auto it = owned.begin(); it != owned.end(); it++ ) {
+		least = min(least, it->second);
+		most = max(most, it->second);
+	}
+	double mine = owned.count(memberNode->addr.getAddress()) ? owned[memberNode->addr.getAddress()] : 0;
+	log->LOG(&memberNode->addr, "#STATSLOG# load: vnodes=%d members=%lu share=%.4f minShare=%.4f maxShare=%.4f primaryKeys=%lu keys=%lu",
+			par->VNODES, (unsigned long)ring.size(), mine, least, most, ht->countReplica(PRIMARY), ht->currentSize());
+}
+
+/**
+ * FUNCTION NAME: logOperationLatency
+ *
+ * DESCRIPTION: Write to stats.log how many ticks the transactions coordinated here took to reach
+ * 				quorum: the median, the 99th percentile and the slowest, over the successful
+ * 				ones. A transaction is settled on the reply that reaches quorum, so an
+ * 				operation whose replicas answer within the tick it was sent in takes 0 ticks.
+ */
+void MP2Node::logOperationLatency() {
+	unsigned long ops = 0;
+	for ( size_t i = 0; i < opLatencies.size(); i++ ) {
+		ops += opLatencies[i];
+	}
+	// smallest latency covering the given fraction of the operations
+	auto percentile = [&](double fraction) {
+		unsigned long seen = 0;
+		for ( size_t i = 0; i < opLatencies.size(); i++ ) {
+			seen += opLatencies[i];
+			if ( seen > 0 && seen >= fraction * ops ) {
+				return (int)i;
+			}
+		}
+		return 0;
+	};
+	log->LOG(&memberNode->addr, "#STATSLOG# latency: ops=%lu failed=%lu p50=%d p99=%d max=%d lateReplies=%lu readRepairs=%lu"
+			" hedgesFired=%lu hedgesWon=%lu", ops, opFailures, percentile(0.5), percentile(0.99), percentile(1.0),
+			lateReplies, readRepairs, hedgesFired, hedgesWon);
+}
+
+/**
+ * FUNCTION NAME: logHintedHandoff
+ *
+ * DESCRIPTION: Write how many writes this node took in as a stand-in, how many it took back
+ * 				from its hint file, how many it handed over and how many it still holds to
+ * 				stats.log, when SLOPPY_QUORUM is on
+ */
+void MP2Node::logHintedHandoff() {
+	if ( !par->SLOPPY_QUORUM ) {
+		return;
+	}
+	log->LOG(&memberNode->addr, "#STATSLOG# hints: stored=%lu recovered=%lu replayed=%lu held=%lu", hintsStored, hintsRecovered, hintsReplayed,
+			(unsigned long)hints.size());
+}
+
+/**
+ * FUNCTION NAME: logTransfers
+ *
+ * DESCRIPTION: Write to stats.log how many bulk transfer streams this node opened, how many of
+ * 				them its receivers acknowledged in full, gave up on or still have open, and how
+ * 				many records it took in from the streams of others, resent batches included
+ */
+void MP2Node::logTransfers() {
+	log->LOG(&memberNode->addr, "#STATSLOG# transfers: streams=%lu completed=%lu abandoned=%lu open=%lu received=%lu",
+			streamsOpened, streamsCompleted, streamsAbandoned, (unsigned long)outgoing.size(), recordsReceived);
+}
+
+/**
+ * FUNCTION NAME: logAntiEntropy
+ *
+ * DESCRIPTION: Write how many anti-entropy rounds this node started as a primary, how many
+ * 				Merkle digests it sent and how many differing leaves it streamed to a replica
+ * 				to stats.log, when ANTI_ENTROPY_INTERVAL is set
+ */
+void MP2Node::logAntiEntropy() {
+	if ( !antiEntropy ) {
+		return;
+	}
+	log->LOG(&memberNode->addr, "#STATSLOG# antiEntropy: rounds=%lu digests=%lu leavesRepaired=%lu",
+			merkleRounds, merkleDigestsSent, merkleLeavesRepaired);
+}
+
+/**
+ * FUNCTION NAME: nodeFileName
+ *
+ * DESCRIPTION: Name of a file belonging to this node: prefix, the address with ':' replaced, suffix
+ */
+string MP2Node::nodeFileName(const string &prefix, const string &suffix) {
+	string name = memberNode->addr.getAddress();
+	replace(name.begin(), name.end(), ':', '_');
+	return prefix + name + suffix;
+}
+
+/**
+ * FUNCTION NAME: recoverFromDisk
+ *
+ * DESCRIPTION: Mount the last snapshot of an earlier run as the base of the hash table, then
+ * 				replay the write-ahead log written since on top of it. Mounting is only an mmap,
+ * 				so reads are served straight from the snapshot while the log tail replays.
+ */
+void MP2Node::recoverFromDisk() {
+	snapshotPath = nodeFileName(SNAPSHOT_FILE_PREFIX, ".snap");
+	if ( ht->loadSnapshot(snapshotPath) ) {
+		log->LOG(&memberNode->addr, "SNAPSHOT: mapped %lu keys from %s", ht->currentSize(), snapshotPath.c_str());
+	}
+	if ( par->WAL_ENABLED ) {
+		wal = new WriteAheadLog(nodeFileName(WAL_FILE_PREFIX, ".log"));
+		recoverFromLog();
+	}
+	scheduleExpiries();
+}
+
+/**
+ * FUNCTION NAME: recoverHints
+ *
+ * DESCRIPTION: Take back the hints left by an earlier run, so a restart does not lose the writes
+ * 				this node acknowledged for replicas that were down, then keep the hints in the
+ * 				hint file
+ */
+void MP2Node::recoverHints() {
+	string path = nodeFileName(HINT_FILE_PREFIX, ".log");
+	unsigned long records = hints.recover(path, par->getcurrtime());
+	if ( hints.getPath().empty() ) {
+		log->LOG(&memberNode->addr, "hints: cannot open %s, hints will not survive a restart", path.c_str());
+	}
+	if ( records > 0 ) {
+		log->LOG(&memberNode->addr, "hints: replayed %lu records from %s, %lu hints recovered",
+				records, path.c_str(), (unsigned long)hints.size());
+	}
+	hintsRecovered = hints.size();
+}
+
+/**
+ * FUNCTION NAME: recoverFromLog
+ *
+ * DESCRIPTION: Replay the write-ahead log left by an earlier run into the hash table, then keep
+ * 				appending to it. The recovered keys are already in place, so the node does not
+ * 				depend on the stabilization protocol to get its replicas back.
+ */
+void MP2Node::recoverFromLog() {
+	Entry entry;
+	unsigned long records = wal->replay([&](WalOp op, const Slice &key, const Slice &value) {
+		switch ( op ) {
+			case WAL_CREATE:
+				if ( entry.decode(value) ) {
+					ht->create(key.toString(), entry);
+				}
+				break;
+			case WAL_UPDATE:
+				if ( entry.decode(value) ) {
+					ht->update(key.toString(), entry);
+				}
+				break;
+			case WAL_DELETE:
+				ht->deleteKey(key.toString());
+				break;
+		}
+	});
+	if ( !wal->open() ) {
+		log->LOG(&memberNode->addr, "WAL: cannot open %s, changes will not be logged", wal->getPath().c_str());
+	}
+	if ( records > 0 ) {
+		log->LOG(&memberNode->addr, "WAL: replayed %lu records from %s, %lu keys recovered",
+				records, wal->getPath().c_str(), ht->currentSize());
+	}
+}
+
+/**
+ * FUNCTION NAME: takeSnapshot
+ *
+ * DESCRIPTION: Write a snapshot of the hash table. Everything committed to the write-ahead log
+ * 				is in it, so the log starts over.
+ */
+void MP2Node::takeSnapshot() {
+	if ( !ht->writeSnapshot(snapshotPath) ) {
+		log->LOG(&memberNode->addr, "SNAPSHOT: writing %s failed", snapshotPath.c_str());
+		return;
+	}
+	if ( wal != NULL && !wal->reset() ) {
+		log->LOG(&memberNode->addr, "WAL: cannot empty %s after snapshot", wal->getPath().c_str());
+	}
+}
+
+// my functions
+void MP2Node::sendMessage(Address toAddr, Message msg) {
+    // CREATE to DELETE expect a reply; sloppy quorum watches for members that stop giving one
+    if (par->SLOPPY_QUORUM && msg.type <= DELETE && toAddr != memberNode->addr) {
+        awaiting.emplace(toAddr.getAddress(), par->getcurrtime());
     }
-}
-
-
-// my functions
-void MP2Node::sendMessage(Address toAddr, Message msg) {
     emulNet->ENsend(&memberNode->addr, &toAddr, msg.toString());
 }
 
 void MP2Node::handleCreateMessage(Message msg) {
+    if (msg.hintFor != Address()) {
+        storeHint(msg);
+        return;
+    }
     Message reply(msg.transID, memberNode->addr, REPLY, msg.key, msg.value, msg.replica);
-    if (!createKeyValue(msg.key, msg.value, msg.replica)) {
+    if (!createKeyValue(msg.key, msg.value, msg.replica, msg.ttl)) {
         log->logCreateFail(&msg.fromAddr, false, msg.transID, msg.key, msg.value);
         reply.success = false;
     } else {
@@ -488,8 +1848,12 @@ void MP2Node::handleCreateMessage(Message msg) {
 }
 
 void MP2Node::handleUpdateMessage(Message msg) {
+    if (msg.hintFor != Address()) {
+        storeHint(msg);
+        return;
+    }
     Message reply(msg.transID, memberNode->addr, REPLY, msg.key, msg.value, msg.replica);
-    if (!updateKeyValue(msg.key, msg.value, msg.replica)) {
+    if (!updateKeyValue(msg.key, msg.value, msg.replica, msg.ttl)) {
         log->logUpdateFail(&msg.fromAddr, false, msg.transID, msg.key, msg.value);
         reply.success = false;
     } else {
@@ -500,8 +1864,14 @@ void MP2Node::handleUpdateMessage(Message msg) {
 }
 
 void MP2Node::handleReadMessage(Message msg) {
-    string res = readKey(msg.key);
+    Entry entry;
+    string res = readEntry(msg.key, &entry) ? entry.value : "";
     Message reply(msg.transID, memberNode->addr, READREPLY, msg.key, res, msg.replica);
+    // the coordinator compares the copies of the replicas, and repairs the older ones
+    reply.timestamp = res.empty() ? -1 : entry.timestamp;
+    if (!res.empty() && entry.expiresAt != 0) {
+        reply.ttl = max(entry.expiresAt - par->getcurrtime(), 1);
+    }
     if (res.empty()) {
         log->logReadFail(&msg.fromAddr, false, msg.transID, msg.key);
         reply.success = false;
@@ -513,6 +1883,8 @@ void MP2Node::handleReadMessage(Message msg) {
 }
 
 void MP2Node::handleDeleteMessage(Message msg) {
+    // remembered even if the key is not here, in case an older copy turns up later
+    recordTombstone(msg.key, par->getcurrtime());
     Message reply(msg.transID, memberNode->addr, REPLY, msg.key, msg.value, msg.replica);
     if (!deletekey(msg.key)) {
         log->logDeleteFail(&msg.fromAddr, false, msg.transID, msg.key);
@@ -525,21 +1897,112 @@ void MP2Node::handleDeleteMessage(Message msg) {
 }
 
 void MP2Node::handleReplyMessage(Message msg) {
-    int txId = msg.transID;
-    auto it = txMap.find(txId);
-
-    if (it != txMap.end()) {
-        Transaction *transaction = &it->second;
+    Transaction *transaction = findTransaction(msg.transID);
 
+    if (transaction != NULL) {
         transaction->totalCount++;
         // READREPLY messages don't use success field, they use value field instead (if fail value is null)
         // see Message(string str) constructor
-        if (msg.type == READREPLY && !msg.value.empty()) {
-            transaction->successCount++;
-            transaction->value = msg.value;
+        if (msg.type == READREPLY) {
+            recordReplyTime(*transaction, msg.fromAddr);
+            transaction->replies.push_back(ReadReply{msg.fromAddr, msg.timestamp, msg.value});
+            if (!msg.value.empty()) {
+                transaction->successCount++;
+                // the newest copy is the answer, whichever replica it came from
+                if (transaction->valueTimestamp < 0
+                        || newerCopy(msg.timestamp, false, msg.value, transaction->valueTimestamp, false, transaction->value)) {
+                    transaction->value = msg.value;
+                    transaction->valueTimestamp = msg.timestamp;
+                    transaction->valueTtl = msg.ttl;
+                }
+            }
         } else if (msg.success) {
             transaction->successCount++;
         }
+
+        // a replica without the key leaves the quorum to the ones held back, so they need not wait
+        if (transaction->hedgePending() && transaction->totalCount > transaction->successCount) {
+            fireHedge(*transaction);
+        }
+
+        // settle the transaction as soon as its outcome is known, rather than on the next tick: it
+        // fails once the replicas yet to answer are too few to make up what it needs
+        int replicas = par->REPLICATION_FACTOR;
+        bool succeeded = transaction->successCount >= transaction->required;
+        if (!transaction->settled
+                && (succeeded || transaction->successCount + replicas - transaction->totalCount < transaction->required)) {
+            finishTransaction(*transaction, succeeded);
+            if (succeeded && transaction->hedgedTo(msg.fromAddr)) {
+                hedgesWon++;
+            }
+        }
+        // a read waits for the last replica it asked too, which may need repairing
+        int asked = transaction->hedgePending() ? replicas - (int)transaction->hedgeReplicas.size() : replicas;
+        if (transaction->settled && (transaction->type != READ || transaction->totalCount == asked)) {
+            closeTransaction(*transaction);
+        }
+    } else {
+        // the transaction was closed without this reply; nothing else to do
+        lateReplies++;
+    }
+}
+
+/**
+ * FUNCTION NAME: fireHedge
+ *
+ * DESCRIPTION: Ask the replicas a hedged read held back
+ */
+void MP2Node::fireHedge(Transaction &transaction) {
+    for (const auto &held : transaction.hedgeReplicas) {
+        Message msg(transaction.txId, memberNode->addr, READ, transaction.key);
+        msg.replica = static_cast<ReplicaType>(held.first);
+        sendMessage(held.second, msg);
+    }
+    transaction.hedgedAt = par->getcurrtime();
+    hedgesFired++;
+}
+
+/**
+ * FUNCTION NAME: recordReplyTime
+ *
+ * DESCRIPTION: Fold the time a replica took to answer a read into its smoothed reply time, which
+ * 				hedged reads order the replicas by. Like a TCP round trip estimate, each reply
+ * 				moves it an eighth of the way.
+ */
+void MP2Node::recordReplyTime(const Transaction &transaction, const Address &from) {
+    bool hedge = transaction.hedgedTo(from);
+    int sample = par->getcurrtime() - (hedge ? transaction.hedgedAt : transaction.timestamp);
+    double &smoothed = replyTimes[from.getAddress()];
+    smoothed += (sample - smoothed) / 8;
+}
+
+/**
+ * FUNCTION NAME: repairRead
+ *
+ * DESCRIPTION: Send the newest copy of a read key to each replica that answered the read with an
+ * 				older copy or none. The copy goes as a one-record batch outside any stream, which
+ * 				the replica merges (see mergeEntry) without acknowledging or remembering it, so a
+ * 				replica that was written in the meantime keeps its write. A repair that is lost
+ * 				is left to the next read or to anti-entropy.
+ */
+void MP2Node::repairRead(const Transaction &transaction) {
+    const vector<Node> &nodes = preferenceList(transaction.key);
+    int expiresAt = transaction.valueTtl > 0 ? par->getcurrtime() + transaction.valueTtl : 0;
+    for (const ReadReply &reply : transaction.replies) {
+        if (reply.timestamp == transaction.valueTimestamp && reply.value == transaction.value) {
+            continue;
+        }
+        // a replica the ring has moved the key off gets it from stabilization, if at all
+        long replica = indexOfNode(nodes, reply.from);
+        if (replica < 0) {
+            continue;
+        }
+        Entry entry(transaction.value, transaction.valueTimestamp, static_cast<ReplicaType>(replica), expiresAt);
+        string payload;
+        appendTransferRecord(&payload, 0, transaction.key, entry.encode());
+        Message msg(TRANSFER_UNACKED_ID, memberNode->addr, entry.replica, 0, 1, payload);
+        sendMessage(reply.from, msg);
+        readRepairs++;
     }
 }
 
@@ -547,10 +2010,56 @@ void MP2Node::handleReadReplyMessage(Message msg) {
 
 }
 
-Transaction::Transaction(MessageType _type, int timestamp) {
+Transaction::Transaction() {
+    this->successCount = 0;
+    this->totalCount = 0;
+    this->type = CREATE;
+    this->txId = -1;
+    this->timestamp = 0;
+    this->valueTimestamp = -1;
+    this->valueTtl = 0;
+    this->required = 1;
+    this->settled = false;
+    this->hedgedAt = -1;
+}
+
+Transaction::Transaction(MessageType _type, int timestamp, int required) {
     this->successCount = 0;
     this->totalCount = 0;
     this->type = _type;
     this->txId = g_transID++;
     this->timestamp = timestamp;
-}
\ No newline at end of file
+    this->valueTimestamp = -1;
+    this->valueTtl = 0;
+    this->required = required;
+    this->settled = false;
+    this->hedgedAt = -1;
+}
+
+/**
+ * FUNCTION NAME: hedgePending
+ *
+ * RETURNS:
+ * true if the read holds back replicas it has not asked yet
+ */
+bool Transaction::hedgePending() const {
+    return !hedgeReplicas.empty() && hedgedAt < 0;
+}
+
+/**
+ * FUNCTION NAME: hedgedTo
+ *
+ * RETURNS:
+ * true if the read held the replica at from back and has asked it since
+ */
+bool Transaction::hedgedTo(const Address &from) const {
+    if (hedgedAt < 0) {
+        return false;
+    }
+    for (const auto &held : hedgeReplicas) {
+        if (held.second == from) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -9,9 +9,25 @@
 #ifndef MP2NODE_H_
 #define MP2NODE_H_
 
-#define QUORUM 2
-#define TOTAL 3
 #define OPERATION_TIMEOUT 20
+// ticks between checks whether the hash table storage should be compacted
+#define COMPACTION_INTERVAL 50
+// write-ahead log of node a.b.c.d:port is WAL_FILE_PREFIX "a.b.c.d_port.log"
+#define WAL_FILE_PREFIX "wal-"
+#define SNAPSHOT_FILE_PREFIX "snap-"
+// hints held with SLOPPY_QUORUM, in the record format of the write-ahead log
+#define HINT_FILE_PREFIX "hints-"
+// table directory of the LSM storage engine
+#define LSM_DIRECTORY_PREFIX "lsm-"
+// keys stabilization places on the ring per batch of hashes
+#define STABILIZATION_BATCH 64
+// transactions a coordinator can have open at once
+#define TRANSACTION_SLOTS 1024
+// ticks a member may leave a request unanswered before sloppy quorum sends its writes to a stand-in
+#define SUSPECT_TIMEOUT 5
+// anti-entropy rounds a replica remembers a delete for, so the replicas that missed it are repaired
+// before the tombstone is dropped
+#define TOMBSTONE_GC_ROUNDS 4
 
 /**
  * Header files
@@ -25,6 +41,19 @@
 #include "Member.h"
 #include "Message.h"
 #include "Queue.h"
+#include "WriteAheadLog.h"
+#include "TimerWheel.h"
+#include "Transfer.h"
+#include "MerkleTree.h"
+#include "HintLog.h"
+#include <set>
+
+// the answer of one replica to a read: value is empty and timestamp -1 if it has no copy
+struct ReadReply {
+    Address from;
+    int timestamp;
+    string value;
+};
 
 class Transaction {
 public:
@@ -32,16 +61,32 @@ public:
     int successCount;
     // how many replies received
     int totalCount;
-    // transaction id
+    // transaction id, -1 while a slot holds no transaction
     int txId;
     // timestamp this transaction was created
     int timestamp;
     // type of transaction, which overlaps partially with MessageType
     MessageType type;
+    // successful replies the transaction needs, from its consistency level
+    int required;
     string key;
     string value;
+    // read: timestamp and time left to live of the newest copy in the replies, -1 before one
+    int valueTimestamp;
+    int valueTtl;
+    // read: every reply so far, to repair the replicas holding an older copy
+    vector<ReadReply> replies;
+    // whether the outcome is logged; a read stays open after that to hear from every replica
+    bool settled;
+    // hedged read: the replicas held back, by index in the preference list and address, and
+    // the tick they were asked, -1 while they are still held back
+    vector<pair<int, Address> > hedgeReplicas;
+    int hedgedAt;
 
-    Transaction(MessageType _type, int timestamp);
+    Transaction();
+    Transaction(MessageType _type, int timestamp, int required);
+    bool hedgePending() const;
+    bool hedgedTo(const Address &from) const;
 };
 
 /**
@@ -56,15 +101,36 @@ public:
  */
 class MP2Node {
 private:
-	// Vector holding the next two neighbors in the ring who have my replicas
+	// Members holding replicas of the ring segments I am the primary of
 	vector<Node> hasMyReplicas;
-	// Vector holding the previous two neighbors in the ring whose replicas I have
+	// Primaries of the ring segments I hold replicas of
 	vector<Node> haveReplicasOf;
 	// Ring
 	vector<Node> ring;
+	// membership epoch of memberNode the ring was last built from
+	unsigned long ringEpoch;
+	// positions of the virtual nodes of the ring members in ring order, searched to place a key
+	vector<uint64_t> ringHashes;
+	// replicas of each ring segment: preferenceLists[i] holds the keys hashing to
+	// (ringHashes[i-1], ringHashes[i]], on par->REPLICATION_FACTOR distinct members
+	vector<vector<Node> > preferenceLists;
 	// Hash Table
-	// the value is serialized in the format of "value:timestamp:replicaType", should use Entry's converToString to serialize
+	// values are stored as Entry records; the "value:timestamp:replicaType" string form is only for logging
 	HashTable * ht;
+	// Redo log of ht, NULL unless the test case enables WAL
+	WriteAheadLog * wal;
+	// where snapshots of ht are written and mounted from
+	string snapshotPath;
+	// expiry times of the keys in ht that have a time to live
+	TimerWheel * expiries;
+	// tick each key deleted here was deleted at, so an older copy from another replica does not
+	// bring it back; dropped tombstoneHorizon ticks later, on tombstoneExpiries
+	map<string, int> tombstones;
+	TimerWheel * tombstoneExpiries;
+	int tombstoneHorizon;
+	// server side reads that found their key, and that did not
+	unsigned long readHits;
+	unsigned long readMisses;
 	// Member representing this member
 	Member *memberNode;
 	// Params object
@@ -75,10 +141,51 @@ private:
 	Log * log;
 	// string delimiter
 	string delimiter;
-	// Transaction map
-	map<int, Message>transMap;
-	// maps txid => success reply count
-	map<int, Transaction> txMap;
+	// open transactions: transaction txId lives in slot txId % TRANSACTION_SLOTS, which is
+	// its own while the slot's txId matches
+	vector<Transaction> txSlots;
+	// timeouts of the open transactions, keyed by txid
+	TimerWheel * txTimeouts;
+	// transactions coordinated here that succeeded, by ticks from start to quorum
+	vector<unsigned long> opLatencies;
+	unsigned long opFailures;
+	// replies that arrived after their transaction was closed
+	unsigned long lateReplies;
+	// replicas sent a newer copy of a key they answered a read with
+	unsigned long readRepairs;
+	// smoothed ticks each replica took to answer reads, by address
+	map<string, double> replyTimes;
+	// when the hedged reads give up waiting on their fastest replicas, keyed by txid
+	TimerWheel * hedges;
+	// hedged reads that asked the replicas held back, and those that one of their replies completed
+	unsigned long hedgesFired;
+	unsigned long hedgesWon;
+	// bulk key transfers this node is sending, by stream id
+	map<int, OutgoingTransfer> outgoing;
+	// id of the next stream this node opens; apart from the transaction ids of client requests
+	int nextStreamId;
+	// streams opened, fully acknowledged and abandoned, and records received in stream batches
+	unsigned long streamsOpened;
+	unsigned long streamsCompleted;
+	unsigned long streamsAbandoned;
+	unsigned long recordsReceived;
+	// bulk key transfers this node is receiving, by sender address and stream id
+	map<pair<string, int>, IncomingTransfer> incoming;
+	// whether ht keeps Merkle trees of the ring segments and replicas exchange them
+	bool antiEntropy;
+	// anti-entropy rounds started, Merkle digests sent and differing leaves streamed to replicas
+	unsigned long merkleRounds;
+	unsigned long merkleDigestsSent;
+	unsigned long merkleLeavesRepaired;
+	// with SLOPPY_QUORUM: tick of the oldest request each member has left unanswered, by address
+	map<string, int> awaiting;
+	// writes taken in for replicas that were down, until they are handed over
+	HintLog hints;
+	// hinted writes taken in, hints taken back from the hint file of an earlier run, and hints
+	// handed over
+	unsigned long hintsStored;
+	unsigned long hintsRecovered;
+	unsigned long hintsReplayed;
 
 public:
 	MP2Node(Member *memberNode, Params *par, EmulNet *emulNet, Log *log, Address *addressOfMember);
@@ -89,16 +196,17 @@ public:
 	// ring functionalities
 	void updateRing();
 	vector<Node> getMembershipList();
-	size_t hashFunction(string key);
+	uint64_t hashFunction(const string &key);
 	bool compareNode(const Node& first, const Node& second) {
 		return first.nodeHashCode < second.nodeHashCode;
 	}
 
-	// client side CRUD APIs
-	void clientCreate(string key, string value);
-	void clientRead(string key);
-	void clientUpdate(string key, string value);
-	void clientDelete(string key);
+	// client side CRUD APIs; a key created or updated with a ttl (in ticks) is deleted once it runs out
+	void clientCreate(string key, string value, int ttl = 0, ConsistencyLevel level = CL_DEFAULT);
+	void clientRead(string key, ConsistencyLevel level = CL_DEFAULT);
+	void clientUpdate(string key, string value, int ttl = 0, ConsistencyLevel level = CL_DEFAULT);
+	void clientDelete(string key, ConsistencyLevel level = CL_DEFAULT);
+	int requiredReplies(MessageType type, ConsistencyLevel level);
 
 	// receive messages from Emulnet
 	bool recvLoop();
@@ -109,19 +217,80 @@ public:
 
 	// find the addresses of nodes that are responsible for a key
 	vector<Node> findNodes(string key);
+	const vector<Node> &preferenceList(const string &key);
+	const vector<Node> &preferenceListAt(uint64_t position);
+	void indexRing();
+	long heardFrom(const Address &address);
+	bool isDown(const Address &address);
+	Address standIn(const string &key, const vector<Address> &taken);
+	void sendWrite(const Address &replica, Message &msg, vector<Address> *standIns);
 
 	// server
-	bool createKeyValue(string key, string value, ReplicaType replica);
+	bool createKeyValue(string key, string value, ReplicaType replica, int ttl = 0);
+	bool createEntry(const string &key, const Entry &entry);
+	bool updateEntry(const string &key, const Entry &entry);
+	bool mergeEntry(const string &key, const Entry &entry);
+	bool readEntry(const string &key, Entry *entry);
 	string readKey(string key);
-	bool updateKeyValue(string key, string value, ReplicaType replica);
+	bool updateKeyValue(string key, string value, ReplicaType replica, int ttl = 0);
 	bool deletekey(string key);
+	void recordTombstone(const string &key, int deletedAt);
+	bool tombstoneOf(const string &key, Entry *entry);
+
+	// delete the keys whose time to live has run out, and forget old tombstones
+	void reapExpired();
+	void dropTombstones();
+	void scheduleExpiries();
+
+	// evict cold keys while ht is over the memory budget
+	void evictOverBudget();
 
 	// stabilization protocol - handle multiple failures
-	void stabilizationProtocol();
+	void stabilizationProtocol(const vector<uint64_t> &oldHashes, const vector<vector<Node> > &oldLists);
+	vector<vector<pair<Address, ReplicaType> > > planTransfers(const vector<uint64_t> &oldHashes,
+			const vector<vector<Node> > &oldLists, vector<uint64_t> *ranges, vector<int> *retags);
+
+	// bulk key transfers; records, if given, are sent in place of reading the keys from ht
+	void startTransfer(const Address &to, ReplicaType replica, vector<string> &keys, vector<string> *records = NULL);
+	void pumpTransfers();
+	void sendTransferBatch(int id, OutgoingTransfer &stream);
+
+	// Merkle tree anti-entropy
+	void startAntiEntropy();
+	void sendMerkleDigests(const Address &to, const vector<MerkleDigest> &digests, bool final);
+	void repairLeaves(const Address &to, const set<pair<size_t, size_t> > &leaves);
+
+	// hinted handoff
+	void storeHint(Message msg);
+	void replayHints();
+
+	// write the memory footprint of the hash table to the stats log
+	void logMemoryFootprint();
+	void logLoadDistribution();
+	void logOperationLatency();
+	void logHintedHandoff();
+	void logTransfers();
+	void logAntiEntropy();
+
+	// per-node file names, e.g. wal-1_0.log
+	string nodeFileName(const string &prefix, const string &suffix);
+
+	// rebuild the hash table from the snapshot and write-ahead log of an earlier run
+	void recoverFromDisk();
+	void recoverHints();
+	void recoverFromLog();
+	void takeSnapshot();
 
 	// my functions
     void sendMessage(Address toAddr, Message msg);
     void updateTransactionMap();
+    void trackTransaction(const Transaction &transaction);
+    Transaction *findTransaction(int txId);
+    void finishTransaction(Transaction &transaction, bool success);
+    void closeTransaction(Transaction &transaction);
+    void repairRead(const Transaction &transaction);
+    void fireHedge(Transaction &transaction);
+    void recordReplyTime(const Transaction &transaction, const Address &from);
 
     // message handlers
     void handleCreateMessage(Message msg);
@@ -130,6 +299,9 @@ public:
     void handleDeleteMessage(Message msg);
     void handleReplyMessage(Message msg);
     void handleReadReplyMessage(Message msg);
+    void handleTransferMessage(Message msg);
+    void handleTransferAckMessage(Message msg);
+    void handleMerkleMessage(Message msg);
 
 	~MP2Node();
 };
@@ -144,7 +316,7 @@ public:
  *   reply: count if quorum is reached (2), log success/fail
  *   read reply: count if quorum reached, log success/fail, return value
  *
- * For each client ops, create a transaction and save it in the txMap with txid (g_transId), increment too
+ * For each client ops, create a transaction and save it in its txSlots slot with txid (g_transId), increment too
  * During check message, when receive reply/replayread msg, update transaction accordingly (totalRcv vs successRcv) and
  * fail this transaction if no reach quorum
  *
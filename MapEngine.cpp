@@ -0,0 +1,138 @@
+/**********************************
+ * FILE NAME: MapEngine.cpp
+ *
+ * DESCRIPTION: std::map storage engine definition
+ **********************************/
+
+#include "MapEngine.h"
+
+MapEngine::MapEngine() {
+	clear();
+}
+
+MapEngine::~MapEngine() {}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Insert the pair unless the key is already present
+ */
+bool MapEngine::insert(const Slice &key, const Slice &value, unsigned char tag) {
+	Item item;
+	item.value = value.toString();
+	item.tag = tag;
+	if ( !table.emplace(key.toString(), item).second ) {
+		return false;
+	}
+	tagCounts[tag]++;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: lookup
+ *
+ * DESCRIPTION: Point value at the stored value of the key
+ *
+ * RETURNS:
+ * false if the key is absent
+ */
+bool MapEngine::lookup(const Slice &key, Slice *value) {
+	map<string, Item>::iterator search = table.find(key.toString());
+	if ( search == table.end() ) {
+		return false;
+	}
+	*value = Slice(search->second.value);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: assign
+ *
+ * DESCRIPTION: Overwrite the value and tag of an existing key
+ */
+bool MapEngine::assign(const Slice &key, const Slice &value, unsigned char tag, string *previous) {
+	map<string, Item>::iterator search = table.find(key.toString());
+	if ( search == table.end() ) {
+		return false;
+	}
+	tagCounts[search->second.tag]--;
+	tagCounts[tag]++;
+	if ( previous != NULL ) {
+		previous->swap(search->second.value);
+	}
+	search->second.value.assign(value.data, value.size);
+	search->second.tag = tag;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Remove the key
+ */
+bool MapEngine::erase(const Slice &key, string *previous) {
+	map<string, Item>::iterator search = table.find(key.toString());
+	if ( search == table.end() ) {
+		return false;
+	}
+	tagCounts[search->second.tag]--;
+	if ( previous != NULL ) {
+		previous->swap(search->second.value);
+	}
+	table.erase(search);
+	return true;
+}
+
+unsigned long MapEngine::size() {
+	return (unsigned long)table.size();
+}
+
+void MapEngine::clear() {
+	table.clear();
+	memset(tagCounts, 0, sizeof(tagCounts));
+}
+
+/**
+ * FUNCTION NAME: scan
+ *
+ * DESCRIPTION: Visit every pair in key order
+ */
+void MapEngine::scan(const function<void(const Slice &, const Slice &)> &visit) {
+	for ( auto it = table.begin(); it != table.end(); ++it ) {
+		visit(Slice(it->first), Slice(it->second.value));
+	}
+}
+
+/**
+ * FUNCTION NAME: scanTag
+ *
+ * DESCRIPTION: Visit the pairs with the tag, in key order
+ */
+void MapEngine::scanTag(unsigned char tag, const function<bool(const Slice &, const Slice &)> &visit) {
+	for ( auto it = table.begin(); it != table.end(); ++it ) {
+		if ( it->second.tag == tag && !visit(Slice(it->first), Slice(it->second.value)) ) {
+			return;
+		}
+	}
+}
+
+unsigned long MapEngine::countTag(unsigned char tag) {
+	return tagCounts[tag];
+}
+
+/**
+ * FUNCTION NAME: getStats
+ *
+ * DESCRIPTION: Estimate the footprint by walking the tree. String buffers are counted by
+ * 				capacity; each tree node is taken as its payload plus four pointers.
+ */
+void MapEngine::getStats(StorageStats *stats) {
+	memset(stats, 0, sizeof(StorageStats));
+	stats->keys = table.size();
+	for ( auto it = table.begin(); it != table.end(); ++it ) {
+		stats->payloadBytes += it->first.size() + it->second.value.size();
+		stats->allocatedBytes += it->first.capacity() + it->second.value.capacity();
+	}
+	stats->reservedBytes = stats->allocatedBytes;
+	stats->indexBytes = table.size() * (sizeof(pair<const string, Item>) + 4 * sizeof(void *));
+}
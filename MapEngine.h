@@ -0,0 +1,46 @@
+/**********************************
+ * FILE NAME: MapEngine.h
+ *
+ * DESCRIPTION: Header file of the std::map storage engine
+ **********************************/
+
+#ifndef MAPENGINE_H_
+#define MAPENGINE_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include "StorageEngine.h"
+
+/**
+ * CLASS NAME: MapEngine
+ *
+ * DESCRIPTION: Ordered storage engine backed by the map provided by C++ STL.
+ * 				Kept as the reference backend; FlatHashEngine is the default.
+ * 				Tags are counted but not indexed, so scanTag() filters a full scan.
+ */
+class MapEngine : public StorageEngine {
+private:
+	struct Item {
+		string value;
+		unsigned char tag;
+	};
+	map<string, Item> table;
+	unsigned long tagCounts[256];
+public:
+	MapEngine();
+	bool insert(const Slice &key, const Slice &value, unsigned char tag);
+	bool lookup(const Slice &key, Slice *value);
+	bool assign(const Slice &key, const Slice &value, unsigned char tag, string *previous = NULL);
+	bool erase(const Slice &key, string *previous = NULL);
+	unsigned long size();
+	void clear();
+	void scan(const function<void(const Slice &, const Slice &)> &visit);
+	void scanTag(unsigned char tag, const function<bool(const Slice &, const Slice &)> &visit);
+	unsigned long countTag(unsigned char tag);
+	void getStats(StorageStats *stats);
+	virtual ~MapEngine();
+};
+
+#endif /* MAPENGINE_H_ */
@@ -109,6 +109,8 @@ public:
 	int timeOutCounter;
 	// Membership table
 	vector<MemberListEntry> memberList;
+	// bumped whenever a member is added to or removed from memberList
+	unsigned long membershipEpoch;
 	// My position in the membership table
 	vector<MemberListEntry>::iterator myPos;
 	// Queue for failure detection messages
@@ -118,7 +120,7 @@ public:
 	/**
 	 * Constructor
 	 */
-	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0) {}
+	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0), membershipEpoch(0) {}
 	// copy constructor
 	Member(const Member &anotherMember);
 	// Assignment operator overloading
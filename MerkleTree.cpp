@@ -0,0 +1,152 @@
+/**********************************
+ * FILE NAME: MerkleTree.cpp
+ *
+ * DESCRIPTION: Definition of the MerkleTree class
+ **********************************/
+
+#include "MerkleTree.h"
+#include "Hash64.h"
+
+/**
+ * FUNCTION NAME: reset
+ *
+ * DESCRIPTION: Start over with empty trees for the given ranges; ends must be sorted. The owner
+ * 				inserts every pair it holds again.
+ */
+void MerkleTree::reset(const vector<uint64_t> &ends) {
+	this->ends = ends;
+	digests.assign(ends.size() * 2 * MERKLE_LEAVES, 0);
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Empty every tree, keeping the ranges
+ */
+void MerkleTree::clear() {
+	fill(digests.begin(), digests.end(), 0);
+}
+
+bool MerkleTree::active() const {
+	return !ends.empty();
+}
+
+void MerkleTree::insert(const Slice &key, const Slice &value) {
+	apply(key, value, true);
+}
+
+void MerkleTree::erase(const Slice &key, const Slice &value) {
+	apply(key, value, false);
+}
+
+/**
+ * FUNCTION NAME: apply
+ *
+ * DESCRIPTION: Add the digest of a pair to, or take it off, its leaf and every node above it
+ */
+void MerkleTree::apply(const Slice &key, const Slice &value, bool add) {
+	size_t range, node;
+	if ( !locate(key, &range, &node) ) {
+		return;
+	}
+	uint64_t digest = hash64(value.data, value.size, hash64(key.data, key.size));
+	uint64_t *tree = &digests[range * 2 * MERKLE_LEAVES];
+	for ( ; node >= 1; node >>= 1 ) {
+		tree[node] += add ? digest : 0 - digest;
+	}
+}
+
+/**
+ * FUNCTION NAME: locate
+ *
+ * DESCRIPTION: Find the range and leaf of a key. The range is the first one ending at or after
+ * 				the key's position, as on the ring; its width is split into MERKLE_LEAVES equal
+ * 				buckets, rounded up. A width of 0 is the whole ring, when there is one range.
+ *
+ * RETURNS:
+ * false if there are no ranges
+ */
+bool MerkleTree::locate(const Slice &key, size_t *range, size_t *leaf) const {
+	if ( ends.empty() ) {
+		return false;
+	}
+	uint64_t position = hash64(key.data, key.size);
+	size_t r = lower_bound(ends.begin(), ends.end(), position) - ends.begin();
+	if ( r == ends.size() ) {
+		r = 0;
+	}
+	uint64_t start = startOf(r);
+	uint64_t bucket = (ends[r] - start - 1) / MERKLE_LEAVES + 1;
+	*range = r;
+	*leaf = MERKLE_LEAVES + (size_t)((position - start - 1) / bucket);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: findRange
+ *
+ * DESCRIPTION: Index of the range (start, end], -1 if there is no such range; another node's
+ * 				view of the ring may not have caught up with this one yet
+ */
+long MerkleTree::findRange(uint64_t start, uint64_t end) const {
+	size_t r = lower_bound(ends.begin(), ends.end(), end) - ends.begin();
+	if ( r == ends.size() || ends[r] != end || startOf(r) != start ) {
+		return -1;
+	}
+	return (long)r;
+}
+
+uint64_t MerkleTree::startOf(size_t range) const {
+	return ends[(range + ends.size() - 1) % ends.size()];
+}
+
+uint64_t MerkleTree::endOf(size_t range) const {
+	return ends[range];
+}
+
+uint64_t MerkleTree::digest(size_t range, size_t node) const {
+	return digests[range * 2 * MERKLE_LEAVES + node];
+}
+
+size_t MerkleTree::ranges() const {
+	return ends.size();
+}
+
+/**
+ * FUNCTION NAME: appendMerkleDigest
+ *
+ * DESCRIPTION: Append one digest to an exchange payload: start | end | node | digest
+ */
+void appendMerkleDigest(string *payload, const MerkleDigest &digest) {
+	char bytes[MERKLE_DIGEST_BYTES];
+	memcpy(bytes, &digest.start, 8);
+	memcpy(bytes + 8, &digest.end, 8);
+	memcpy(bytes + 16, &digest.node, 4);
+	memcpy(bytes + 20, &digest.digest, 8);
+	payload->append(bytes, MERKLE_DIGEST_BYTES);
+}
+
+/**
+ * FUNCTION NAME: decodeMerkleDigests
+ *
+ * DESCRIPTION: Decode the digests of an exchange payload, dropping nodes outside a tree
+ *
+ * RETURNS:
+ * false if the payload is not a whole number of digests
+ */
+bool decodeMerkleDigests(const string &payload, vector<MerkleDigest> *digests) {
+	if ( payload.size() % MERKLE_DIGEST_BYTES != 0 ) {
+		return false;
+	}
+	MerkleDigest digest;
+	for ( size_t offset = 0; offset < payload.size(); offset += MERKLE_DIGEST_BYTES ) {
+		memcpy(&digest.start, &payload[offset], 8);
+		memcpy(&digest.end, &payload[offset + 8], 8);
+		memcpy(&digest.node, &payload[offset + 16], 4);
+		memcpy(&digest.digest, &payload[offset + 20], 8);
+		if ( digest.node >= 1 && digest.node < 2 * MERKLE_LEAVES ) {
+			digests->push_back(digest);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,76 @@
+/**********************************
+ * FILE NAME: MerkleTree.h
+ *
+ * DESCRIPTION: Header file of the MerkleTree class, digests of the keys of each ring range
+ **********************************/
+
+#ifndef MERKLETREE_H_
+#define MERKLETREE_H_
+
+#include "stdincludes.h"
+#include "Slice.h"
+
+/*
+ * Macros
+ */
+// leaves of the tree of each range; a power of two
+#define MERKLE_LEAVES 64
+// start, end, node and digest of one entry of an exchange payload
+#define MERKLE_DIGEST_BYTES 28
+// room left in a message for the header in front of the digests
+#define MERKLE_HEADER_BYTES 64
+
+/**
+ * STRUCT NAME: MerkleDigest
+ *
+ * DESCRIPTION: Digest of one tree node of the range (start, end], as exchanged between replicas
+ */
+struct MerkleDigest {
+	uint64_t start;
+	uint64_t end;
+	uint32_t node;
+	uint64_t digest;
+};
+
+/**
+ * CLASS NAME: MerkleTree
+ *
+ * DESCRIPTION: One hash tree per range of the ring. A range is split evenly into MERKLE_LEAVES
+ * 				buckets by key position; the digest of a bucket is the sum of the digests of its
+ * 				keys and values, and every node above holds the sum of its children. Sums do not
+ * 				depend on the order keys were written in, so replicas holding the same pairs
+ * 				have the same digests, and a write costs one update per level instead of
+ * 				rehashing anything.
+ * 				The digest of a pair leaves out its timestamp and replica type, which differ
+ * 				between replicas of the same write.
+ * 				Nodes are numbered in heap order: 1 is the root, node n has children 2n and
+ * 				2n + 1, and the leaves are MERKLE_LEAVES to 2 * MERKLE_LEAVES - 1.
+ * 				Until ranges are set there are no trees and writes cost nothing.
+ */
+class MerkleTree {
+private:
+	// ends[r] is the last position of range r, which holds (ends[r-1], ends[r]]; the first
+	// range wraps around the top of the ring
+	vector<uint64_t> ends;
+	// 2 * MERKLE_LEAVES digests per range, node 0 unused
+	vector<uint64_t> digests;
+	void apply(const Slice &key, const Slice &value, bool add);
+public:
+	void reset(const vector<uint64_t> &ends);
+	void clear();
+	bool active() const;
+	void insert(const Slice &key, const Slice &value);
+	void erase(const Slice &key, const Slice &value);
+	bool locate(const Slice &key, size_t *range, size_t *leaf) const;
+	long findRange(uint64_t start, uint64_t end) const;
+	uint64_t startOf(size_t range) const;
+	uint64_t endOf(size_t range) const;
+	uint64_t digest(size_t range, size_t node) const;
+	size_t ranges() const;
+};
+
+void appendMerkleDigest(string *payload, const MerkleDigest &digest);
+// decode an exchange payload; returns false if it is malformed
+bool decodeMerkleDigests(const string &payload, vector<MerkleDigest> *digests);
+
+#endif /* MERKLETREE_H_ */
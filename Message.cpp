@@ -8,12 +8,15 @@
 /**
  * Constructor
  */
-// transID::fromAddr::CREATE::key::value::ReplicaType
+// transID::fromAddr::CREATE::key::value::ReplicaType[::ttl[::hintFor]]
 // transID::fromAddr::READ::key
-// transID::fromAddr::UPDATE::key::value::ReplicaType
+// transID::fromAddr::UPDATE::key::value::ReplicaType[::ttl[::hintFor]]
 // transID::fromAddr::DELETE::key
 // transID::fromAddr::REPLY::sucess
-// transID::fromAddr::READREPLY::value
+// transID::fromAddr::READREPLY::value::timestamp::ttl
+// transID::fromAddr::TRANSFER::ReplicaType::offset::end::payload (binary, see Transfer.h)
+// transID::fromAddr::TRANSFERACK::offset
+// transID::fromAddr::MERKLE::offset::payload (binary, see MerkleTree.h)
 Message::Message(string message){
 	this->delimiter = "::";
 	vector<string> tuple;
@@ -27,6 +30,10 @@ Message::Message(string message){
 	}
 	tuple.push_back(message.substr(start));
 
+	ttl = 0;
+	timestamp = 0;
+	offset = 0;
+	end = 0;
 	transID = stoi(tuple.at(0));
 	Address addr(tuple.at(1));
 	fromAddr = addr;
@@ -38,6 +45,10 @@ Message::Message(string message){
 			value = tuple.at(4);
 			if (tuple.size() > 5)
 				replica = static_cast<ReplicaType>(stoi(tuple.at(5)));
+			if (tuple.size() > 6)
+				ttl = stoi(tuple.at(6));
+			if (tuple.size() > 7)
+				hintFor = Address(tuple.at(7));
 			break;
 		case READ:
 		case DELETE:
@@ -49,9 +60,39 @@ Message::Message(string message){
 			else
 				success = false;
 			break;
-		case READREPLY:
-			value = tuple.at(3);
+		case READREPLY: {
+			// the value may hold the delimiter: it runs from the third one to the last but one
+			timestamp = stoi(tuple.at(tuple.size() - 2));
+			ttl = stoi(tuple.back());
+			size_t first = 0;
+			for (int i = 0; i < 3; i++)
+				first = message.find(delimiter, first) + 2;
+			size_t last = message.rfind(delimiter, message.rfind(delimiter) - 1);
+			value = message.substr(first, last - first);
+			break;
+		}
+		case TRANSFER: {
+			replica = static_cast<ReplicaType>(stoi(tuple.at(3)));
+			offset = stoi(tuple.at(4));
+			end = stoi(tuple.at(5));
+			// the payload may hold the delimiter: take everything after the sixth one
+			size_t payload = 0;
+			for (int i = 0; i < 6; i++)
+				payload = message.find(delimiter, payload) + 2;
+			value = message.substr(payload);
+			break;
+		}
+		case TRANSFERACK:
+			offset = stoi(tuple.at(3));
+			break;
+		case MERKLE: {
+			offset = stoi(tuple.at(3));
+			size_t payload = 0;
+			for (int i = 0; i < 4; i++)
+				payload = message.find(delimiter, payload) + 2;
+			value = message.substr(payload);
 			break;
+		}
 	}
 }
 
@@ -61,6 +102,10 @@ Message::Message(string message){
 // construct a create or update message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	offset = 0;
+	end = 0;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -81,6 +126,11 @@ Message::Message(const Message& anotherMessage) {
 	this->transID = anotherMessage.transID;
 	this->type = anotherMessage.type;
 	this->value = anotherMessage.value;
+	this->ttl = anotherMessage.ttl;
+	this->timestamp = anotherMessage.timestamp;
+	this->offset = anotherMessage.offset;
+	this->end = anotherMessage.end;
+	this->hintFor = anotherMessage.hintFor;
 }
 
 /**
@@ -88,6 +138,10 @@ Message::Message(const Message& anotherMessage) {
  */
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	offset = 0;
+	end = 0;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -101,6 +155,10 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 // construct a read or delete message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	offset = 0;
+	end = 0;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -113,6 +171,10 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 // construct reply message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, bool _success){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	offset = 0;
+	end = 0;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -125,12 +187,64 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, bool _succe
 // construct read reply message
 Message::Message(int _transID, Address _fromAddr, string _value){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	offset = 0;
+	end = 0;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = READREPLY;
 	value = _value;
 }
 
+/**
+ * Constructor
+ */
+// construct a transfer batch message
+Message::Message(int _transID, Address _fromAddr, ReplicaType _replica, int _offset, int _end, string _payload){
+	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	transID = _transID;
+	fromAddr = _fromAddr;
+	type = TRANSFER;
+	replica = _replica;
+	offset = _offset;
+	end = _end;
+	value = _payload;
+}
+
+/**
+ * Constructor
+ */
+// construct a transfer ack message
+Message::Message(int _transID, Address _fromAddr, int _offset){
+	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	transID = _transID;
+	fromAddr = _fromAddr;
+	type = TRANSFERACK;
+	offset = _offset;
+	end = 0;
+}
+
+/**
+ * Constructor
+ */
+// construct a Merkle digest exchange message
+Message::Message(int _transID, Address _fromAddr, bool _final, string _payload){
+	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	transID = _transID;
+	fromAddr = _fromAddr;
+	type = MERKLE;
+	offset = _final ? 1 : 0;
+	end = 0;
+	value = _payload;
+}
+
 /**
  * FUNCTION NAME: toString
  *
@@ -142,6 +256,10 @@ string Message::toString(){
 		case CREATE:
 		case UPDATE:
 			message += key + delimiter + value + delimiter + to_string(replica);
+			if (ttl > 0 || hintFor != Address())
+				message += delimiter + to_string(ttl);
+			if (hintFor != Address())
+				message += delimiter + hintFor.getAddress();
 			break;
 		case READ:
 		case DELETE:
@@ -154,7 +272,16 @@ string Message::toString(){
 				message += "0";
 			break;
 		case READREPLY:
-			message += value;
+			message += value + delimiter + to_string(timestamp) + delimiter + to_string(ttl);
+			break;
+		case TRANSFER:
+			message += to_string(replica) + delimiter + to_string(offset) + delimiter + to_string(end) + delimiter + value;
+			break;
+		case TRANSFERACK:
+			message += to_string(offset);
+			break;
+		case MERKLE:
+			message += to_string(offset) + delimiter + value;
 			break;
 	}
 	return message;
@@ -172,5 +299,10 @@ Message& Message::operator =(const Message& anotherMessage) {
 	this->transID = anotherMessage.transID;
 	this->type = anotherMessage.type;
 	this->value = anotherMessage.value;
+	this->ttl = anotherMessage.ttl;
+	this->timestamp = anotherMessage.timestamp;
+	this->offset = anotherMessage.offset;
+	this->end = anotherMessage.end;
+	this->hintFor = anotherMessage.hintFor;
 	return *this;
 }
@@ -24,6 +24,17 @@ public:
 	Address fromAddr;
 	int transID;
 	bool success; // success or not 
+	// time to live of a created or updated key in ticks, 0 if it never expires; in a read reply,
+	// what is left of it
+	int ttl;
+	// read reply: timestamp of the replica's copy of the key
+	int timestamp;
+	// transfer: the batch holds the stream offsets [offset, end); ack: every offset before offset arrived
+	// merkle: offset is 1 if the digests answer differing leaves and want no answer back
+	int offset;
+	int end;
+	// create or update sent to a stand-in for a replica that is down: that replica, null otherwise
+	Address hintFor;
 	// delimiter
 	string delimiter;
 	// construct a message from a string
@@ -38,6 +49,12 @@ public:
 	Message(int _transID, Address _fromAddr, MessageType _type, bool _success);
 	// construct read reply message
 	Message(int _transID, Address _fromAddr, string _value);
+	// construct a transfer batch message
+	Message(int _transID, Address _fromAddr, ReplicaType _replica, int _offset, int _end, string _payload);
+	// construct a transfer ack message
+	Message(int _transID, Address _fromAddr, int _offset);
+	// construct a Merkle digest exchange message
+	Message(int _transID, Address _fromAddr, bool _final, string _payload);
 	Message& operator = (const Message& anotherMessage);
 	// serialize to a string
 	string toString();
@@ -27,10 +27,10 @@ Node::~Node() {}
 /**
  * FUNCTION NAME: computeHashCode
  *
- * DESCRIPTION: This function computes the hash code of the node address
+ * DESCRIPTION: This function computes the hash code of the node address: hash64 of its six bytes
  */
 void Node::computeHashCode() {
-	nodeHashCode = hashFunc(nodeAddress.addr)%RING_SIZE;
+	nodeHashCode = hash64(nodeAddress.addr, sizeof(nodeAddress.addr));
 }
 
 /**
@@ -62,10 +62,20 @@ bool Node::operator < (const Node& another) const {
  *
  * DESCRIPTION: return hash code of the node
  */
-size_t Node::getHashCode() {
+uint64_t Node::getHashCode() {
 	return nodeHashCode;
 }
 
+/**
+ * FUNCTION NAME: tokenHashCode
+ *
+ * DESCRIPTION: Ring position of the node's virtual node number vnode: the address hashed with
+ * 				vnode as the seed, so virtual node 0 is the node's own hash code
+ */
+uint64_t Node::tokenHashCode(int vnode) {
+	return hash64(nodeAddress.addr, sizeof(nodeAddress.addr), (uint64_t)vnode);
+}
+
 /**
  * FUNCTION NAME: getAddress
  *
@@ -80,7 +90,7 @@ Address * Node::getAddress() {
  *
  * DESCRIPTION: set the hash code of the node
  */
-void Node::setHashCode(size_t hashCode) {
+void Node::setHashCode(uint64_t hashCode) {
 	this->nodeHashCode = hashCode;
 }
 
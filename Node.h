@@ -9,21 +9,23 @@
 
 #include "stdincludes.h"
 #include "Member.h"
+#include "Hash64.h"
 
 class Node {
 public:
 	Address nodeAddress;
-	size_t nodeHashCode;
-	std::hash<string> hashFunc;
+	// position on the ring, anywhere in the 64-bit token space
+	uint64_t nodeHashCode;
 	Node();
 	Node(Address address);
 	Node(const Node& another);
 	Node& operator=(const Node& another);
 	bool operator < (const Node& another) const;
 	void computeHashCode();
-	size_t getHashCode();
+	uint64_t getHashCode();
+	uint64_t tokenHashCode(int vnode);
 	Address * getAddress();
-	void setHashCode(size_t hashCode);
+	void setHashCode(uint64_t hashCode);
 	void setAddress(Address address);
 	virtual ~Node();
 };
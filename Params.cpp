@@ -27,6 +27,14 @@ void Params::setparams(char *config_file) {
 	fscanf(fp,"\nMSG_DROP_PROB: %lf", &MSG_DROP_PROB);
 	fscanf(fp,"\nCRUD_TEST: %s", CRUD);
 
+	// Optional settings, all off unless the test case asks for them
+	char name[64];
+	char value[64];
+	optional.clear();
+	while ( fscanf(fp, " %63[^:]: %63s", name, value) == 2 ) {
+		optional[name] = value;
+	}
+
 	auto type = testTypeMap.find(CRUD);
 	if(type == testTypeMap.end()){
 		throw std::runtime_error("Unavailable Test Type!");
@@ -46,11 +54,60 @@ void Params::setparams(char *config_file) {
 	for ( int i = 0; i < EN_GPSZ; i++ ) {
 		allNodesJoined += i;
 	}
+	WAL_ENABLED = optionalInt("WAL", 0);
+	SNAPSHOT_INTERVAL = optionalInt("SNAPSHOT_INTERVAL", 0);
+	STORAGE_ENGINE = FLAT_HASH_ENGINE;
+	if ( optional.count("STORAGE_ENGINE") != 0 ) {
+		auto engine = storageEngineMap.find(optional["STORAGE_ENGINE"]);
+		if ( engine == storageEngineMap.end() ) {
+			throw std::runtime_error("Unavailable Storage Engine!");
+		}
+		STORAGE_ENGINE = engine->second;
+	}
+	VNODES = max(1, optionalInt("VNODES", 1));
+	MEMORY_BUDGET = optionalInt("MEMORY_BUDGET", 0);
+	ANTI_ENTROPY_INTERVAL = optionalInt("ANTI_ENTROPY_INTERVAL", 0);
+	REPLICATION_FACTOR = optionalInt("REPLICATION_FACTOR", 3);
+	if ( REPLICATION_FACTOR < 1 ) {
+		throw std::runtime_error("REPLICATION_FACTOR must be at least 1!");
+	}
+	if ( REPLICATION_FACTOR > MAX_REPLICATION_FACTOR ) {
+		throw std::runtime_error("REPLICATION_FACTOR must be at most 64!");
+	}
+	// a majority of the replicas unless set
+	READ_QUORUM = optionalInt("READ_QUORUM", REPLICATION_FACTOR / 2 + 1);
+	WRITE_QUORUM = optionalInt("WRITE_QUORUM", REPLICATION_FACTOR / 2 + 1);
+	if ( READ_QUORUM < 1 || WRITE_QUORUM < 1 ) {
+		throw std::runtime_error("READ_QUORUM and WRITE_QUORUM must be at least 1!");
+	}
+	if ( READ_QUORUM > REPLICATION_FACTOR || WRITE_QUORUM > REPLICATION_FACTOR ) {
+		throw std::runtime_error("READ_QUORUM and WRITE_QUORUM must not exceed REPLICATION_FACTOR!");
+	}
+	// every read quorum must overlap every write quorum to see the last write
+	if ( READ_QUORUM + WRITE_QUORUM <= REPLICATION_FACTOR ) {
+		throw std::runtime_error("READ_QUORUM + WRITE_QUORUM must exceed REPLICATION_FACTOR!");
+	}
+	HEDGE_DELAY = optionalInt("HEDGE_DELAY", 0);
+	SLOPPY_QUORUM = optionalInt("SLOPPY_QUORUM", 0);
+	KEY_TTL = optionalInt("KEY_TTL", 0);
 	fclose(fp);
 	//trace.funcExit("Params::setparams", SUCCESS);
 	return;
 }
 
+/**
+ * FUNCTION NAME: optionalInt
+ *
+ * DESCRIPTION: Integer value of an optional setting, or defaultValue if the test case leaves it out
+ */
+int Params::optionalInt(const string &name, int defaultValue) {
+	auto search = optional.find(name);
+	if ( search == optional.end() ) {
+		return defaultValue;
+	}
+	return atoi(search->second.c_str());
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
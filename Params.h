@@ -10,6 +10,14 @@
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "StorageEngine.h"
+
+/*
+ * Macros
+ */
+// replica types share a byte of the stored record with ENTRY_FLAG_EXPIRES (0x80) and
+// ENTRY_FLAG_DELETED (0x40), so only the low 6 bits are left for them
+#define MAX_REPLICATION_FACTOR 64
 
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
 static std::unordered_map<std::string,testTYPE> const testTypeMap = {
@@ -18,6 +26,11 @@ static std::unordered_map<std::string,testTYPE> const testTypeMap = {
 		{"UPDATE",testTYPE::UPDATE_TEST},
 		{"DELETE",testTYPE::DELETE_TEST},
 };
+static std::unordered_map<std::string,StorageEngineType> const storageEngineMap = {
+		{"FLAT",FLAT_HASH_ENGINE},
+		{"MAP",MAP_ENGINE},
+		{"LSM",LSM_ENGINE},
+};
 
 
 /**
@@ -39,9 +52,25 @@ public:
 	int allNodesJoined;
 	short PORTNUM;
 	int CRUDTEST;
+	int WAL_ENABLED;			// keep a write-ahead log of each node's hash table
+	int SNAPSHOT_INTERVAL;		// ticks between snapshots of each node's hash table, 0 for none
+	StorageEngineType STORAGE_ENGINE;	// backend of each node's hash table
+	int VNODES;					// virtual nodes each member places on the ring
+	int MEMORY_BUDGET;			// bytes of keys and values each node's hash table may hold, 0 for no limit
+	int ANTI_ENTROPY_INTERVAL;	// ticks between Merkle tree exchanges with the replicas, 0 (the default) for none
+	int REPLICATION_FACTOR;		// replicas of each key
+	int READ_QUORUM;			// replicas a read waits for by default
+	int WRITE_QUORUM;			// replicas a create, update or delete waits for by default
+	int SLOPPY_QUORUM;			// send writes for a replica that is down to a stand-in, which hands them over later
+	int HEDGE_DELAY;			// ticks a read waits on its fastest replicas before asking the rest, 0 to ask all at once
+	int KEY_TTL;				// ticks to live the test keys are created with, 0 for permanent keys
 	Params();
 	void setparams(char *);
 	int getcurrtime();
+private:
+	// optional "NAME: value" lines following the fixed ones
+	map<string, string> optional;
+	int optionalInt(const string &name, int defaultValue);
 };
 
 #endif /* _PARAMS_H_ */
@@ -0,0 +1,447 @@
+/**********************************
+ * FILE NAME: SSTable.cpp
+ *
+ * DESCRIPTION: Definition of the sorted string table classes
+ **********************************/
+
+#include "SSTable.h"
+#include "Checksum.h"
+
+/**
+ * FUNCTION NAME: compareKeys
+ *
+ * DESCRIPTION: Bytewise key order, a prefix sorting first
+ */
+int compareKeys(const Slice &first, const Slice &second) {
+	int cmp = memcmp(first.data, second.data, min(first.size, second.size));
+	if ( cmp != 0 ) {
+		return cmp;
+	}
+	if ( first.size == second.size ) {
+		return 0;
+	}
+	return first.size < second.size ? -1 : 1;
+}
+
+/**
+ * FUNCTION NAME: parseRecord
+ *
+ * DESCRIPTION: Decode the record starting at position of a data block
+ *
+ * RETURNS:
+ * position of the next record, 0 if the record runs past the end of the block
+ */
+static size_t parseRecord(const string &block, size_t position, Slice *key, Slice *value,
+		unsigned char *tag, bool *deleted) {
+	if ( position + SSTABLE_RECORD_HEADER > block.size() ) {
+		return 0;
+	}
+	uint32_t keySize, valueSize;
+	memcpy(&keySize, &block[position], sizeof(uint32_t));
+	memcpy(&valueSize, &block[position + 4], sizeof(uint32_t));
+	size_t end = position + SSTABLE_RECORD_HEADER + (size_t)keySize + valueSize;
+	if ( end > block.size() ) {
+		return 0;
+	}
+	*tag = (unsigned char)block[position + 8];
+	*deleted = (block[position + 9] & SSTABLE_FLAG_DELETED) != 0;
+	*key = Slice(block.data() + position + SSTABLE_RECORD_HEADER, keySize);
+	*value = Slice(block.data() + position + SSTABLE_RECORD_HEADER + keySize, valueSize);
+	return end;
+}
+
+/**
+ * constructor
+ */
+TableBuilder::TableBuilder(const string &path): offset(0), entries(0), failed(false) {
+	fp = fopen(path.c_str(), "wb");
+	failed = fp == NULL;
+}
+
+/**
+ * Destructor
+ */
+TableBuilder::~TableBuilder() {
+	if ( fp != NULL ) {
+		fclose(fp);
+	}
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Append a record; keys must come in strictly increasing order
+ */
+void TableBuilder::add(const Slice &key, const Slice &value, unsigned char tag, bool deleted) {
+	if ( entries == 0 ) {
+		// The index starts with the smallest key of the table
+		uint32_t keySize = (uint32_t)key.size;
+		index.append((const char *)&keySize, sizeof(uint32_t));
+		index.append(key.data, key.size);
+	}
+	uint32_t keySize = (uint32_t)key.size;
+	uint32_t valueSize = (uint32_t)value.size;
+	char flags = deleted ? SSTABLE_FLAG_DELETED : 0;
+	block.append((const char *)&keySize, sizeof(uint32_t));
+	block.append((const char *)&valueSize, sizeof(uint32_t));
+	block.push_back((char)tag);
+	block.push_back(flags);
+	block.append(key.data, key.size);
+	block.append(value.data, value.size);
+	lastKey.assign(key.data, key.size);
+	keyHashes.push_back(BloomFilter::hash(key));
+	entries++;
+	if ( block.size() >= SSTABLE_BLOCK_SIZE ) {
+		flushBlock();
+	}
+}
+
+/**
+ * FUNCTION NAME: flushBlock
+ *
+ * DESCRIPTION: Write the pending data block and add its handle to the index
+ */
+void TableBuilder::flushBlock() {
+	if ( block.empty() ) {
+		return;
+	}
+	if ( !failed && fwrite(block.data(), 1, block.size(), fp) != block.size() ) {
+		failed = true;
+	}
+	uint32_t size = (uint32_t)block.size();
+	uint32_t crc = crc32(block.data(), block.size());
+	uint32_t keySize = (uint32_t)lastKey.size();
+	index.append((const char *)&offset, sizeof(uint64_t));
+	index.append((const char *)&size, sizeof(uint32_t));
+	index.append((const char *)&crc, sizeof(uint32_t));
+	index.append((const char *)&keySize, sizeof(uint32_t));
+	index.append(lastKey);
+	offset += block.size();
+	block.clear();
+}
+
+/**
+ * FUNCTION NAME: finish
+ *
+ * DESCRIPTION: Write the last block, the filter, the index and the footer, and close the file
+ *
+ * RETURNS:
+ * false if any write failed
+ */
+bool TableBuilder::finish() {
+	flushBlock();
+	BloomFilter filter;
+	filter.reset(keyHashes.size());
+	for ( size_t i = 0; i < keyHashes.size(); i++ ) {
+		filter.addHash(keyHashes[i]);
+	}
+	const string &filterBlock = filter.encoded();
+	uint64_t filterOffset = offset;
+	uint64_t filterSize = filterBlock.size();
+	uint64_t indexOffset = filterOffset + filterSize;
+	uint64_t indexSize = index.size();
+
+	char footer[SSTABLE_FOOTER_SIZE];
+	memcpy(footer, &indexOffset, sizeof(uint64_t));
+	memcpy(footer + 8, &indexSize, sizeof(uint64_t));
+	memcpy(footer + 16, &filterOffset, sizeof(uint64_t));
+	memcpy(footer + 24, &filterSize, sizeof(uint64_t));
+	memcpy(footer + 32, &entries, sizeof(uint64_t));
+	memcpy(footer + 40, SSTABLE_MAGIC, 8);
+	if ( !failed ) {
+		failed = fwrite(filterBlock.data(), 1, filterBlock.size(), fp) != filterBlock.size()
+				|| fwrite(index.data(), 1, index.size(), fp) != index.size()
+				|| fwrite(footer, 1, SSTABLE_FOOTER_SIZE, fp) != SSTABLE_FOOTER_SIZE;
+	}
+	offset += filterSize + index.size() + SSTABLE_FOOTER_SIZE;
+	if ( fp != NULL && fclose(fp) != 0 ) {
+		failed = true;
+	}
+	fp = NULL;
+	return !failed;
+}
+
+uint64_t TableBuilder::fileSize() const {
+	return offset + block.size();
+}
+
+uint64_t TableBuilder::getEntries() const {
+	return entries;
+}
+
+/**
+ * constructor
+ */
+SSTable::SSTable(const string &path, uint64_t id): path(path), id(id), fd(-1), size(0), entries(0), obsolete(false) {}
+
+/**
+ * Destructor
+ */
+SSTable::~SSTable() {
+	if ( fd >= 0 ) {
+		close(fd);
+	}
+	if ( obsolete ) {
+		unlink(path.c_str());
+	}
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Open the file and load its Bloom filter and block index
+ *
+ * RETURNS:
+ * false if the file is missing or malformed
+ */
+bool SSTable::open() {
+	fd = ::open(path.c_str(), O_RDONLY);
+	if ( fd < 0 ) {
+		return false;
+	}
+	off_t end = lseek(fd, 0, SEEK_END);
+	if ( end < SSTABLE_FOOTER_SIZE ) {
+		return false;
+	}
+	size = (uint64_t)end;
+	char footer[SSTABLE_FOOTER_SIZE];
+	if ( pread(fd, footer, SSTABLE_FOOTER_SIZE, end - SSTABLE_FOOTER_SIZE) != SSTABLE_FOOTER_SIZE
+			|| memcmp(footer + 40, SSTABLE_MAGIC, 8) != 0 ) {
+		return false;
+	}
+	uint64_t indexOffset, indexSize, filterOffset, filterSize;
+	memcpy(&indexOffset, footer, sizeof(uint64_t));
+	memcpy(&indexSize, footer + 8, sizeof(uint64_t));
+	memcpy(&filterOffset, footer + 16, sizeof(uint64_t));
+	memcpy(&filterSize, footer + 24, sizeof(uint64_t));
+	memcpy(&entries, footer + 32, sizeof(uint64_t));
+	if ( indexOffset + indexSize + SSTABLE_FOOTER_SIZE != size || filterOffset + filterSize != indexOffset ) {
+		return false;
+	}
+	string filterBlock(filterSize, '\0');
+	if ( pread(fd, &filterBlock[0], filterSize, (off_t)filterOffset) != (ssize_t)filterSize ) {
+		return false;
+	}
+	filter.load(Slice(filterBlock));
+	string index(indexSize, '\0');
+	if ( pread(fd, &index[0], indexSize, (off_t)indexOffset) != (ssize_t)indexSize ) {
+		return false;
+	}
+
+	size_t position = 0;
+	uint32_t keySize;
+	if ( index.size() < sizeof(uint32_t) ) {
+		return false;
+	}
+	memcpy(&keySize, &index[0], sizeof(uint32_t));
+	position = sizeof(uint32_t);
+	if ( position + keySize > index.size() ) {
+		return false;
+	}
+	smallest.assign(index, position, keySize);
+	position += keySize;
+	while ( position < index.size() ) {
+		if ( position + 20 > index.size() ) {
+			return false;
+		}
+		BlockHandle handle;
+		memcpy(&handle.offset, &index[position], sizeof(uint64_t));
+		memcpy(&handle.size, &index[position + 8], sizeof(uint32_t));
+		memcpy(&handle.crc, &index[position + 12], sizeof(uint32_t));
+		memcpy(&keySize, &index[position + 16], sizeof(uint32_t));
+		position += 20;
+		if ( position + keySize > index.size() || handle.offset + handle.size > filterOffset ) {
+			return false;
+		}
+		handle.lastKey.assign(index, position, keySize);
+		position += keySize;
+		blocks.push_back(handle);
+	}
+	return !blocks.empty();
+}
+
+/**
+ * FUNCTION NAME: mayContain
+ *
+ * DESCRIPTION: Ask the Bloom filter of the table about a key hash (see BloomFilter::hash)
+ *
+ * RETURNS:
+ * false if the table definitely does not hold the key
+ */
+bool SSTable::mayContain(uint64_t keyHash) const {
+	return filter.mayContainHash(keyHash);
+}
+
+/**
+ * FUNCTION NAME: readBlock
+ *
+ * DESCRIPTION: Read one data block from the file and verify its checksum
+ */
+bool SSTable::readBlock(uint32_t number, string *contents) const {
+	const BlockHandle &handle = blocks[number];
+	contents->resize(handle.size);
+	if ( pread(fd, &(*contents)[0], handle.size, (off_t)handle.offset) != (ssize_t)handle.size ) {
+		return false;
+	}
+	return crc32(contents->data(), contents->size()) == handle.crc;
+}
+
+/**
+ * FUNCTION NAME: get
+ *
+ * DESCRIPTION: Point lookup: binary search the index for the only block that can hold the key,
+ * 				fetch it through the cache and scan it
+ *
+ * RETURNS:
+ * true with the record (possibly a tombstone) if the table has the key
+ * false otherwise
+ */
+bool SSTable::get(const Slice &key, BlockCache *cache, Found *found) const {
+	uint32_t low = 0;
+	uint32_t high = (uint32_t)blocks.size();
+	while ( low < high ) {
+		uint32_t mid = low + (high - low) / 2;
+		if ( compareKeys(Slice(blocks[mid].lastKey), key) < 0 ) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	if ( low == blocks.size() ) {
+		return false;
+	}
+
+	shared_ptr<const string> block = cache->lookup(id, low);
+	if ( !block ) {
+		string *contents = new string();
+		if ( !readBlock(low, contents) ) {
+			delete contents;
+			return false;
+		}
+		block.reset(contents);
+		cache->insert(id, low, block);
+	}
+
+	Slice recordKey, recordValue;
+	unsigned char tag;
+	bool deleted;
+	size_t position = 0;
+	while ( (position = parseRecord(*block, position, &recordKey, &recordValue, &tag, &deleted)) != 0 ) {
+		int cmp = compareKeys(recordKey, key);
+		if ( cmp == 0 ) {
+			found->value.assign(recordValue.data, recordValue.size);
+			found->tag = tag;
+			found->deleted = deleted;
+			return true;
+		}
+		if ( cmp > 0 ) {
+			break;
+		}
+	}
+	return false;
+}
+
+uint64_t SSTable::getId() const {
+	return id;
+}
+
+uint64_t SSTable::fileSize() const {
+	return size;
+}
+
+uint64_t SSTable::getEntries() const {
+	return entries;
+}
+
+Slice SSTable::smallestKey() const {
+	return Slice(smallest);
+}
+
+Slice SSTable::largestKey() const {
+	return Slice(blocks.back().lastKey);
+}
+
+/**
+ * FUNCTION NAME: indexBytes
+ *
+ * DESCRIPTION: Memory held by the in-memory block index and Bloom filter
+ */
+size_t SSTable::indexBytes() const {
+	size_t bytes = blocks.capacity() * sizeof(BlockHandle) + smallest.capacity() + filter.memoryBytes();
+	for ( size_t i = 0; i < blocks.size(); i++ ) {
+		bytes += blocks[i].lastKey.capacity();
+	}
+	return bytes;
+}
+
+/**
+ * FUNCTION NAME: markObsolete
+ *
+ * DESCRIPTION: Delete the file once nothing refers to this table any more
+ */
+void SSTable::markObsolete() {
+	obsolete = true;
+}
+
+/**
+ * constructor
+ */
+TableIterator::TableIterator(const SSTable *table): table(table), blockNumber(0), position(0),
+		currentTag(0), currentDeleted(false), atEnd(false) {
+	loadBlock();
+}
+
+/**
+ * FUNCTION NAME: loadBlock
+ *
+ * DESCRIPTION: Read the block at blockNumber and position on its first record. An unreadable
+ * 				block ends the scan.
+ */
+void TableIterator::loadBlock() {
+	if ( blockNumber >= table->blocks.size() || !table->readBlock(blockNumber, &contents) ) {
+		atEnd = true;
+		return;
+	}
+	position = 0;
+	parse();
+}
+
+/**
+ * FUNCTION NAME: parse
+ *
+ * DESCRIPTION: Decode the record at position, moving on to the next block at the end of this one
+ */
+void TableIterator::parse() {
+	size_t next = parseRecord(contents, position, &currentKey, &currentValue, &currentTag, &currentDeleted);
+	if ( next == 0 ) {
+		blockNumber++;
+		loadBlock();
+		return;
+	}
+	position = next;
+}
+
+bool TableIterator::valid() const {
+	return !atEnd;
+}
+
+void TableIterator::next() {
+	parse();
+}
+
+Slice TableIterator::key() const {
+	return currentKey;
+}
+
+Slice TableIterator::value() const {
+	return currentValue;
+}
+
+unsigned char TableIterator::tag() const {
+	return currentTag;
+}
+
+bool TableIterator::deleted() const {
+	return currentDeleted;
+}
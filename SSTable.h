@@ -0,0 +1,155 @@
+/**********************************
+ * FILE NAME: SSTable.h
+ *
+ * DESCRIPTION: Header file of the sorted string table classes used by LSMEngine
+ **********************************/
+
+#ifndef SSTABLE_H_
+#define SSTABLE_H_
+
+#include "stdincludes.h"
+#include "Slice.h"
+#include "BlockCache.h"
+#include "BloomFilter.h"
+#include <atomic>
+
+/*
+ * Macros
+ */
+// a data block is closed once it reaches this many bytes
+#define SSTABLE_BLOCK_SIZE 4096
+// record header: uint32 key size | uint32 value size | uint8 tag | uint8 flags
+#define SSTABLE_RECORD_HEADER 10
+#define SSTABLE_FLAG_DELETED 1
+// footer: uint64 index offset | uint64 index size | uint64 filter offset | uint64 filter size |
+// uint64 entries | magic[8]
+#define SSTABLE_FOOTER_SIZE 48
+#define SSTABLE_MAGIC "KVLSMT2"
+
+// bytewise order of keys; negative, zero or positive like memcmp
+int compareKeys(const Slice &first, const Slice &second);
+
+/**
+ * CLASS NAME: LSMIterator
+ *
+ * DESCRIPTION: Forward iterator over records in key order, tombstones included
+ */
+class LSMIterator {
+public:
+	virtual bool valid() const = 0;
+	virtual void next() = 0;
+	virtual Slice key() const = 0;
+	virtual Slice value() const = 0;
+	virtual unsigned char tag() const = 0;
+	virtual bool deleted() const = 0;
+	virtual ~LSMIterator() {}
+};
+
+/**
+ * CLASS NAME: TableBuilder
+ *
+ * DESCRIPTION: Writes records, added in increasing key order, as an SSTable file:
+ * 				data blocks of records (see SSTABLE_RECORD_HEADER), then a Bloom filter of
+ * 				the keys, then an index with the offset, size, CRC-32 and last key of every
+ * 				block, then a fixed-size footer.
+ */
+class TableBuilder {
+private:
+	FILE *fp;
+	string block;
+	string index;
+	uint64_t offset;
+	uint64_t entries;
+	string lastKey;
+	// hashes of every key added, turned into the filter by finish()
+	vector<uint64_t> keyHashes;
+	bool failed;
+
+	void flushBlock();
+public:
+	TableBuilder(const string &path);
+	void add(const Slice &key, const Slice &value, unsigned char tag, bool deleted);
+	bool finish();
+	uint64_t fileSize() const;
+	uint64_t getEntries() const;
+	virtual ~TableBuilder();
+};
+
+/**
+ * CLASS NAME: SSTable
+ *
+ * DESCRIPTION: An immutable table file. The block index and Bloom filter are kept in memory;
+ * 				blocks are read with pread on demand, through the block cache for point lookups.
+ * 				A table marked obsolete deletes its file once the last reference to it is gone.
+ */
+class SSTable {
+private:
+	struct BlockHandle {
+		uint64_t offset;
+		uint32_t size;
+		uint32_t crc;
+		string lastKey;
+	};
+	string path;
+	uint64_t id;
+	int fd;
+	uint64_t size;
+	uint64_t entries;
+	vector<BlockHandle> blocks;
+	string smallest;
+	BloomFilter filter;
+	atomic<bool> obsolete;
+
+	friend class TableIterator;
+	bool readBlock(uint32_t number, string *contents) const;
+public:
+	struct Found {
+		string value;
+		unsigned char tag;
+		bool deleted;
+	};
+	SSTable(const string &path, uint64_t id);
+	bool open();
+	bool mayContain(uint64_t keyHash) const;
+	bool get(const Slice &key, BlockCache *cache, Found *found) const;
+	uint64_t getId() const;
+	uint64_t fileSize() const;
+	uint64_t getEntries() const;
+	Slice smallestKey() const;
+	Slice largestKey() const;
+	size_t indexBytes() const;
+	void markObsolete();
+	virtual ~SSTable();
+};
+
+/**
+ * CLASS NAME: TableIterator
+ *
+ * DESCRIPTION: Sequential scan of one table, block by block, bypassing the block cache so
+ * 				compactions and full scans do not flush it
+ */
+class TableIterator : public LSMIterator {
+private:
+	const SSTable *table;
+	uint32_t blockNumber;
+	string contents;
+	size_t position;
+	Slice currentKey;
+	Slice currentValue;
+	unsigned char currentTag;
+	bool currentDeleted;
+	bool atEnd;
+
+	void loadBlock();
+	void parse();
+public:
+	TableIterator(const SSTable *table);
+	bool valid() const;
+	void next();
+	Slice key() const;
+	Slice value() const;
+	unsigned char tag() const;
+	bool deleted() const;
+};
+
+#endif /* SSTABLE_H_ */
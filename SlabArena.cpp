@@ -0,0 +1,292 @@
+/**********************************
+ * FILE NAME: SlabArena.cpp
+ *
+ * DESCRIPTION: Definition of the SlabArena class
+ **********************************/
+
+#include "SlabArena.h"
+
+/**
+ * constructor
+ */
+SlabArena::SlabArena() {
+	// size classes grow by about a quarter, in steps of 8 bytes, up to 16 chunks per slab
+	uint32_t size = SLAB_MIN_CHUNK;
+	while ( size < SLAB_SIZE / 16 ) {
+		classSizes.push_back(size);
+		size = max(size + 8, ((size + size / 4) + 7) & ~7u);
+	}
+	classSizes.push_back(SLAB_SIZE / 16);
+	reservedBytes = 0;
+	allocatedBytes = 0;
+	freeBytes = 0;
+	freeHeads.assign(classSizes.size(), SLAB_NULL_REF);
+	bumpSlabs.assign(classSizes.size(), -1);
+}
+
+/**
+ * Destructor
+ */
+SlabArena::~SlabArena() {
+	clear();
+}
+
+/**
+ * FUNCTION NAME: classOf
+ *
+ * DESCRIPTION: Smallest size class that fits size
+ *
+ * RETURNS:
+ * class index
+ * -1 if the size needs a dedicated slab
+ */
+int SlabArena::classOf(uint32_t size) const {
+	vector<uint32_t>::const_iterator it = lower_bound(classSizes.begin(), classSizes.end(), size);
+	if ( it == classSizes.end() ) {
+		return -1;
+	}
+	return (int)(it - classSizes.begin());
+}
+
+/**
+ * FUNCTION NAME: newSlab
+ *
+ * DESCRIPTION: Reserve memory for a slab, reusing the id of a dropped one if possible.
+ * 				Throws bad_alloc if there is no memory or no slab id left.
+ */
+uint32_t SlabArena::newSlab(uint32_t chunkSize, uint32_t chunkCount, int sizeClass) {
+	if ( freeSlabIds.empty() && slabs.size() > UINT32_MAX ) {
+		throw bad_alloc();
+	}
+	char *memory = (char *)malloc((size_t)chunkSize * chunkCount);
+	if ( memory == NULL ) {
+		throw bad_alloc();
+	}
+	uint32_t id;
+	if ( !freeSlabIds.empty() ) {
+		id = freeSlabIds.back();
+		freeSlabIds.pop_back();
+	}
+	else {
+		id = (uint32_t)slabs.size();
+		slabs.emplace_back();
+	}
+	Slab &slab = slabs[id];
+	slab.memory = memory;
+	slab.chunkSize = chunkSize;
+	slab.chunkCount = chunkCount;
+	slab.bumpNext = 0;
+	slab.live = 0;
+	slab.sizeClass = sizeClass;
+	slab.evacuating = false;
+	reservedBytes += (unsigned long)chunkSize * chunkCount;
+	return id;
+}
+
+/**
+ * FUNCTION NAME: dropSlab
+ *
+ * DESCRIPTION: Give the memory of a slab back to the system
+ */
+void SlabArena::dropSlab(uint32_t slabId) {
+	Slab &slab = slabs[slabId];
+	reservedBytes -= (unsigned long)slab.chunkSize * slab.chunkCount;
+	free(slab.memory);
+	slab.memory = NULL;
+	slab.live = 0;
+	slab.evacuating = false;
+	freeSlabIds.push_back(slabId);
+}
+
+/**
+ * FUNCTION NAME: rebuildFreeList
+ *
+ * DESCRIPTION: Drop the chunks of evacuating slabs from the free list of a class
+ */
+void SlabArena::rebuildFreeList(int sizeClass) {
+	ArenaRef ref = freeHeads[sizeClass];
+	ArenaRef *tail = &freeHeads[sizeClass];
+	while ( ref != SLAB_NULL_REF ) {
+		ArenaRef next;
+		memcpy(&next, at(ref), sizeof(ArenaRef));
+		if ( slabs[ref >> SLAB_CHUNK_BITS].evacuating ) {
+			freeBytes -= classSizes[sizeClass];
+		}
+		else {
+			*tail = ref;
+			tail = (ArenaRef *)at(ref);
+		}
+		ref = next;
+	}
+	*tail = SLAB_NULL_REF;
+}
+
+/**
+ * FUNCTION NAME: allocate
+ *
+ * DESCRIPTION: Hand out a block of at least size bytes: a freed chunk of the size class first,
+ * 				then the next untouched chunk of the class's current slab, then a new slab
+ */
+ArenaRef SlabArena::allocate(uint32_t size) {
+	int sizeClass = classOf(size);
+	if ( sizeClass < 0 ) {
+		uint32_t id = newSlab((size + 7) & ~7u, 1, -1);
+		slabs[id].bumpNext = 1;
+		slabs[id].live = 1;
+		allocatedBytes += slabs[id].chunkSize;
+		return (ArenaRef)id << SLAB_CHUNK_BITS;
+	}
+
+	ArenaRef ref = freeHeads[sizeClass];
+	if ( ref != SLAB_NULL_REF ) {
+		memcpy(&freeHeads[sizeClass], at(ref), sizeof(ArenaRef));
+		freeBytes -= classSizes[sizeClass];
+	}
+	else {
+		long bump = bumpSlabs[sizeClass];
+		if ( bump < 0 || slabs[bump].bumpNext == slabs[bump].chunkCount ) {
+			bump = newSlab(classSizes[sizeClass], SLAB_SIZE / classSizes[sizeClass], sizeClass);
+			bumpSlabs[sizeClass] = bump;
+		}
+		ref = ((ArenaRef)bump << SLAB_CHUNK_BITS) | slabs[bump].bumpNext++;
+	}
+	slabs[ref >> SLAB_CHUNK_BITS].live++;
+	allocatedBytes += classSizes[sizeClass];
+	return ref;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Return a block. Dedicated slabs are dropped straight away; chunks of an evacuating
+ * 				slab are only counted, since the slab is about to be dropped as a whole.
+ */
+void SlabArena::release(ArenaRef ref) {
+	uint32_t id = (uint32_t)(ref >> SLAB_CHUNK_BITS);
+	Slab &slab = slabs[id];
+	slab.live--;
+	allocatedBytes -= slab.chunkSize;
+	if ( slab.sizeClass < 0 ) {
+		dropSlab(id);
+		return;
+	}
+	if ( slab.evacuating ) {
+		return;
+	}
+	memcpy(at(ref), &freeHeads[slab.sizeClass], sizeof(ArenaRef));
+	freeHeads[slab.sizeClass] = ref;
+	freeBytes += slab.chunkSize;
+}
+
+/**
+ * FUNCTION NAME: at
+ *
+ * DESCRIPTION: Address of a block. Valid until the block is released or moved by compaction.
+ */
+char *SlabArena::at(ArenaRef ref) const {
+	const Slab &slab = slabs[ref >> SLAB_CHUNK_BITS];
+	return slab.memory + (size_t)(ref & (((ArenaRef)1 << SLAB_CHUNK_BITS) - 1)) * slab.chunkSize;
+}
+
+/**
+ * FUNCTION NAME: blockSize
+ *
+ * DESCRIPTION: Bytes actually set aside for a request of size bytes. A block can be rewritten in
+ * 				place with any size that has the same blockSize.
+ */
+uint32_t SlabArena::blockSize(uint32_t size) const {
+	int sizeClass = classOf(size);
+	if ( sizeClass < 0 ) {
+		return (size + 7) & ~7u;
+	}
+	return classSizes[sizeClass];
+}
+
+/**
+ * FUNCTION NAME: needsCompaction
+ *
+ * DESCRIPTION: True once enough of the reserved memory sits on free lists to be worth moving
+ * 				blocks for. Untouched chunks at the end of a slab do not count; they are handed
+ * 				out before any new slab is reserved.
+ */
+bool SlabArena::needsCompaction() const {
+	return freeBytes >= (unsigned long)SLAB_COMPACT_MIN_SLABS * SLAB_SIZE
+			&& freeBytes > (freeBytes + allocatedBytes) * SLAB_COMPACT_WASTE;
+}
+
+/**
+ * FUNCTION NAME: beginCompaction
+ *
+ * DESCRIPTION: Mark every sparse slab, except the ones classes are still carving new chunks from,
+ * 				and take their chunks off the free lists so nothing is allocated there meanwhile
+ */
+void SlabArena::beginCompaction() {
+	vector<bool> touched(classSizes.size(), false);
+	for ( size_t id = 0; id < slabs.size(); id++ ) {
+		Slab &slab = slabs[id];
+		if ( slab.memory == NULL || slab.sizeClass < 0 || bumpSlabs[slab.sizeClass] == (long)id ) {
+			continue;
+		}
+		if ( (unsigned long)slab.live * SLAB_SPARSE_RATIO < slab.chunkCount ) {
+			slab.evacuating = true;
+			touched[slab.sizeClass] = true;
+		}
+	}
+	for ( size_t c = 0; c < classSizes.size(); c++ ) {
+		if ( touched[c] ) {
+			rebuildFreeList((int)c);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: isEvacuating
+ *
+ * DESCRIPTION: Whether the block has to be moved before endCompaction()
+ */
+bool SlabArena::isEvacuating(ArenaRef ref) const {
+	return slabs[ref >> SLAB_CHUNK_BITS].evacuating;
+}
+
+/**
+ * FUNCTION NAME: endCompaction
+ *
+ * DESCRIPTION: Drop the evacuated slabs. The owner must have moved every block out of them.
+ */
+void SlabArena::endCompaction() {
+	for ( size_t id = 0; id < slabs.size(); id++ ) {
+		if ( slabs[id].memory != NULL && slabs[id].evacuating ) {
+			dropSlab((uint32_t)id);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Release every slab; all outstanding references become invalid
+ */
+void SlabArena::clear() {
+	for ( size_t id = 0; id < slabs.size(); id++ ) {
+		free(slabs[id].memory);
+	}
+	slabs.clear();
+	freeSlabIds.clear();
+	freeHeads.assign(classSizes.size(), SLAB_NULL_REF);
+	bumpSlabs.assign(classSizes.size(), -1);
+	reservedBytes = 0;
+	allocatedBytes = 0;
+	freeBytes = 0;
+}
+
+unsigned long SlabArena::getReservedBytes() const {
+	return reservedBytes;
+}
+
+unsigned long SlabArena::getAllocatedBytes() const {
+	return allocatedBytes;
+}
+
+unsigned long SlabArena::getSlabCount() const {
+	return (unsigned long)(slabs.size() - freeSlabIds.size());
+}
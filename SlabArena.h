@@ -0,0 +1,89 @@
+/**********************************
+ * FILE NAME: SlabArena.h
+ *
+ * DESCRIPTION: Header file of the SlabArena class
+ **********************************/
+
+#ifndef SLABARENA_H_
+#define SLABARENA_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+#define SLAB_SIZE 65536
+// a reference is slab index << SLAB_CHUNK_BITS | chunk index; slab ids are 32 bits wide,
+// so a 64-bit reference never runs out and never reaches SLAB_NULL_REF
+#define SLAB_CHUNK_BITS 12
+#define SLAB_MIN_CHUNK 16
+#define SLAB_NULL_REF (~(ArenaRef)0)
+// compact once this share of the reserved bytes is not handed out
+#define SLAB_COMPACT_WASTE 0.5
+// and only if at least this many slabs would be worth of memory
+#define SLAB_COMPACT_MIN_SLABS 4
+// slabs less than 1 / SLAB_SPARSE_RATIO full are evacuated by compaction
+#define SLAB_SPARSE_RATIO 4
+
+typedef uint64_t ArenaRef;
+
+/**
+ * CLASS NAME: SlabArena
+ *
+ * DESCRIPTION: Byte allocator for small, frequently replaced blocks. Requests are rounded up
+ * 				to a size class and carved out of 64KB slabs holding chunks of that class only;
+ * 				released chunks go on a free list threaded through the chunks themselves.
+ * 				Requests above the largest class get a dedicated slab of their own.
+ * 				allocate() throws bad_alloc when the system is out of memory.
+ *
+ * 				Compaction is driven by the owner of the references:
+ * 				beginCompaction() marks sparse slabs, the owner moves every block for which
+ * 				isEvacuating() holds to a fresh allocate(), and endCompaction() returns the
+ * 				emptied slabs to the system.
+ */
+class SlabArena {
+private:
+	struct Slab {
+		char *memory;
+		uint32_t chunkSize;
+		uint32_t chunkCount;
+		// chunks below this index have been handed out at least once
+		uint32_t bumpNext;
+		uint32_t live;
+		// size class, or -1 for a dedicated slab
+		int sizeClass;
+		bool evacuating;
+	};
+	vector<Slab> slabs;
+	vector<uint32_t> freeSlabIds;
+	vector<uint32_t> classSizes;
+	vector<ArenaRef> freeHeads;
+	vector<long> bumpSlabs;
+	unsigned long reservedBytes;
+	unsigned long allocatedBytes;
+	// bytes of chunks sitting on free lists
+	unsigned long freeBytes;
+
+	int classOf(uint32_t size) const;
+	uint32_t newSlab(uint32_t chunkSize, uint32_t chunkCount, int sizeClass);
+	void dropSlab(uint32_t slabId);
+	void rebuildFreeList(int sizeClass);
+public:
+	SlabArena();
+	ArenaRef allocate(uint32_t size);
+	void release(ArenaRef ref);
+	char *at(ArenaRef ref) const;
+	// bytes a block of the given size really occupies
+	uint32_t blockSize(uint32_t size) const;
+	bool needsCompaction() const;
+	void beginCompaction();
+	bool isEvacuating(ArenaRef ref) const;
+	void endCompaction();
+	void clear();
+	unsigned long getReservedBytes() const;
+	unsigned long getAllocatedBytes() const;
+	unsigned long getSlabCount() const;
+	virtual ~SlabArena();
+};
+
+#endif /* SLABARENA_H_ */
@@ -0,0 +1,36 @@
+/**********************************
+ * FILE NAME: Slice.h
+ *
+ * DESCRIPTION: Header file of the Slice class
+ **********************************/
+
+#ifndef SLICE_H_
+#define SLICE_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: Slice
+ *
+ * DESCRIPTION: A view of bytes owned by someone else (usually a storage engine).
+ * 				A Slice is only valid while its owner leaves the bytes in place.
+ */
+class Slice {
+public:
+	const char *data;
+	size_t size;
+	Slice(): data(""), size(0) {}
+	Slice(const char *_data, size_t _size): data(_data), size(_size) {}
+	Slice(const string &str): data(str.data()), size(str.size()) {}
+	string toString() const {
+		return string(data, size);
+	}
+	bool operator==(const Slice &another) const {
+		return size == another.size && memcmp(data, another.data, size) == 0;
+	}
+	bool operator!=(const Slice &another) const {
+		return !(*this == another);
+	}
+};
+
+#endif /* SLICE_H_ */
@@ -0,0 +1,226 @@
+/**********************************
+ * FILE NAME: Snapshot.cpp
+ *
+ * DESCRIPTION: Definition of the Snapshot class
+ **********************************/
+
+#include "Snapshot.h"
+#include "Checksum.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * constructor
+ */
+Snapshot::Snapshot(): base(NULL), length(0), count(0), index(NULL), tags(NULL) {}
+
+/**
+ * Destructor
+ */
+Snapshot::~Snapshot() {
+	close();
+}
+
+/**
+ * FUNCTION NAME: lessKey
+ *
+ * DESCRIPTION: Bytewise key order, a prefix sorting first
+ */
+bool Snapshot::lessKey(const Slice &first, const Slice &second) {
+	int cmp = memcmp(first.data, second.data, min(first.size, second.size));
+	return cmp < 0 || (cmp == 0 && first.size < second.size);
+}
+
+/**
+ * FUNCTION NAME: write
+ *
+ * DESCRIPTION: Sort the items by key and write them as a snapshot. The file is built under a
+ * 				temporary name, fsynced and renamed over path, so a crash leaves either the old
+ * 				snapshot or the new one. A snapshot already mapped from path stays readable.
+ *
+ * RETURNS:
+ * false if the snapshot could not be written; path is left untouched
+ */
+bool Snapshot::write(const string &path, vector<SnapshotItem> &items) {
+	sort(items.begin(), items.end(), [](const SnapshotItem &first, const SnapshotItem &second) {
+		return lessKey(first.key, second.key);
+	});
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+	header.count = items.size();
+	header.indexOffset = sizeof(Header);
+	header.tagOffset = header.indexOffset + items.size() * sizeof(IndexEntry);
+
+	BloomFilter keyFilter;
+	keyFilter.reset(items.size());
+	for ( size_t i = 0; i < items.size(); i++ ) {
+		keyFilter.add(items[i].key);
+	}
+	const string &filterBlock = keyFilter.encoded();
+	header.filterSize = (uint32_t)filterBlock.size();
+	header.dataOffset = header.tagOffset + items.size() + header.filterSize;
+
+	vector<IndexEntry> entries(items.size());
+	string tagBlock(items.size(), '\0');
+	uint64_t offset = header.dataOffset;
+	for ( size_t i = 0; i < items.size(); i++ ) {
+		entries[i].offset = offset;
+		entries[i].keySize = (uint32_t)items[i].key.size;
+		entries[i].valueSize = (uint32_t)items[i].value.size;
+		tagBlock[i] = (char)items[i].tag;
+		offset += items[i].key.size + items[i].value.size;
+	}
+	header.indexChecksum = crc32((const char *)entries.data(), entries.size() * sizeof(IndexEntry));
+
+	string tmpPath = path + ".tmp";
+	FILE *fp = fopen(tmpPath.c_str(), "wb");
+	if ( fp == NULL ) {
+		return false;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	ok = ok && fwrite(entries.data(), sizeof(IndexEntry), entries.size(), fp) == entries.size();
+	ok = ok && fwrite(tagBlock.data(), 1, tagBlock.size(), fp) == tagBlock.size();
+	ok = ok && fwrite(filterBlock.data(), 1, filterBlock.size(), fp) == filterBlock.size();
+	for ( size_t i = 0; ok && i < items.size(); i++ ) {
+		ok = fwrite(items[i].key.data, 1, items[i].key.size, fp) == items[i].key.size
+				&& fwrite(items[i].value.data, 1, items[i].value.size, fp) == items[i].value.size;
+	}
+	ok = ok && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+	ok = (fclose(fp) == 0) && ok;
+	if ( !ok || rename(tmpPath.c_str(), path.c_str()) != 0 ) {
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Map a snapshot file read-only and check its header and index
+ *
+ * RETURNS:
+ * false if there is no usable snapshot at path
+ */
+bool Snapshot::open(const string &path) {
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if ( fd < 0 ) {
+		return false;
+	}
+	struct stat st;
+	if ( fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header) ) {
+		::close(fd);
+		return false;
+	}
+	void *mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping keeps the file alive on its own
+	::close(fd);
+	if ( mapped == MAP_FAILED ) {
+		return false;
+	}
+	base = (char *)mapped;
+	length = (size_t)st.st_size;
+
+	Header header;
+	memcpy(&header, base, sizeof(Header));
+	bool valid = memcmp(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) == 0
+			&& header.indexOffset == sizeof(Header)
+			&& header.tagOffset == header.indexOffset + header.count * sizeof(IndexEntry)
+			&& header.dataOffset == header.tagOffset + header.count + header.filterSize
+			&& header.dataOffset <= length;
+	if ( valid ) {
+		index = (const IndexEntry *)(base + header.indexOffset);
+		tags = (const unsigned char *)(base + header.tagOffset);
+		filter = Slice(base + header.tagOffset + header.count, header.filterSize);
+		count = (unsigned long)header.count;
+		valid = crc32((const char *)index, count * sizeof(IndexEntry)) == header.indexChecksum;
+	}
+	for ( unsigned long i = 0; valid && i < count; i++ ) {
+		valid = index[i].offset >= header.dataOffset
+				&& index[i].offset + index[i].keySize + index[i].valueSize <= length;
+	}
+	if ( !valid ) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: close
+ *
+ * DESCRIPTION: Unmap the snapshot; every Slice handed out becomes invalid
+ */
+void Snapshot::close() {
+	if ( base != NULL ) {
+		munmap(base, length);
+	}
+	base = NULL;
+	length = 0;
+	count = 0;
+	index = NULL;
+	tags = NULL;
+	filter = Slice();
+}
+
+/**
+ * FUNCTION NAME: mayContain
+ *
+ * DESCRIPTION: Ask the Bloom filter of the snapshot about key
+ *
+ * RETURNS:
+ * false if the key is definitely not in the snapshot
+ */
+bool Snapshot::mayContain(const Slice &key) const {
+	return BloomFilter::mayContain(filter, BloomFilter::hash(key));
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Binary search of the index for key
+ *
+ * RETURNS:
+ * position of the key
+ * -1 if it is not in the snapshot
+ */
+long Snapshot::find(const Slice &key) const {
+	unsigned long low = 0;
+	unsigned long high = count;
+	while ( low < high ) {
+		unsigned long mid = low + (high - low) / 2;
+		if ( lessKey(keyAt(mid), key) ) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	if ( low < count && keyAt(low) == key ) {
+		return (long)low;
+	}
+	return -1;
+}
+
+unsigned long Snapshot::size() const {
+	return count;
+}
+
+Slice Snapshot::keyAt(unsigned long position) const {
+	return Slice(base + index[position].offset, index[position].keySize);
+}
+
+Slice Snapshot::valueAt(unsigned long position) const {
+	return Slice(base + index[position].offset + index[position].keySize, index[position].valueSize);
+}
+
+unsigned char Snapshot::tagAt(unsigned long position) const {
+	return tags[position];
+}
+
+size_t Snapshot::mappedBytes() const {
+	return length;
+}
@@ -0,0 +1,86 @@
+/**********************************
+ * FILE NAME: Snapshot.h
+ *
+ * DESCRIPTION: Header file of the Snapshot class
+ **********************************/
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include "stdincludes.h"
+#include "Slice.h"
+#include "BloomFilter.h"
+
+/*
+ * Macros
+ */
+#define SNAPSHOT_MAGIC "KVSNAP1"
+#define SNAPSHOT_MAGIC_SIZE 8
+
+/**
+ * STRUCT NAME: SnapshotItem
+ *
+ * DESCRIPTION: One pair handed to Snapshot::write
+ */
+struct SnapshotItem {
+	Slice key;
+	Slice value;
+	unsigned char tag;
+};
+
+/**
+ * CLASS NAME: Snapshot
+ *
+ * DESCRIPTION: Read-only, memory-mapped image of a key => value table.
+ * 				File layout, all integers little endian:
+ * 				header  magic[8] | uint64 count | uint64 index offset | uint64 tag offset |
+ * 				        uint64 data offset | uint32 CRC-32 of the index | uint32 filter size
+ * 				index   count x (uint64 data offset | uint32 key size | uint32 value size), sorted by key
+ * 				tags    count x uint8
+ * 				filter  Bloom filter of the keys (see BloomFilter), absent in older snapshots
+ * 				data    key bytes followed by value bytes, for every pair
+ * 				Opening only maps the file and checks the index, so a lookup is a binary search over
+ * 				the index that touches a handful of pages; the filter, queried in place, turns most
+ * 				misses away before that. The tag block lets a caller count or filter pairs by tag
+ * 				without reading any values.
+ */
+class Snapshot {
+private:
+	struct IndexEntry {
+		uint64_t offset;
+		uint32_t keySize;
+		uint32_t valueSize;
+	};
+	struct Header {
+		char magic[SNAPSHOT_MAGIC_SIZE];
+		uint64_t count;
+		uint64_t indexOffset;
+		uint64_t tagOffset;
+		uint64_t dataOffset;
+		uint32_t indexChecksum;
+		uint32_t filterSize;
+	};
+	char *base;
+	size_t length;
+	unsigned long count;
+	const IndexEntry *index;
+	const unsigned char *tags;
+	Slice filter;
+
+	static bool lessKey(const Slice &first, const Slice &second);
+public:
+	Snapshot();
+	static bool write(const string &path, vector<SnapshotItem> &items);
+	bool open(const string &path);
+	void close();
+	bool mayContain(const Slice &key) const;
+	long find(const Slice &key) const;
+	unsigned long size() const;
+	Slice keyAt(unsigned long position) const;
+	Slice valueAt(unsigned long position) const;
+	unsigned char tagAt(unsigned long position) const;
+	size_t mappedBytes() const;
+	virtual ~Snapshot();
+};
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,146 @@
+/**********************************
+ * FILE NAME: StorageBench.cpp
+ *
+ * DESCRIPTION: Benchmark of the storage engines behind HashTable
+ * 				Usage: ./StorageBench [keys] [value bytes]
+ **********************************/
+
+#include "stdincludes.h"
+#include "MapEngine.h"
+#include "FlatHashEngine.h"
+#include "LSMEngine.h"
+#include <chrono>
+
+#define BENCH_DEFAULT_KEYS 200000
+#define BENCH_DEFAULT_VALUE_BYTES 100
+#define BENCH_LSM_DIRECTORY "lsm-bench"
+
+/**
+ * FUNCTION NAME: elapsedSeconds
+ *
+ * DESCRIPTION: Seconds since start
+ */
+static double elapsedSeconds(const chrono::steady_clock::time_point &start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * FUNCTION NAME: report
+ *
+ * DESCRIPTION: Print the throughput of one phase
+ */
+static void report(const char *engine, const char *phase, unsigned long operations, double seconds) {
+	printf("%-6s %-10s %10lu ops %9.3f s %12.0f ops/s\n", engine, phase, operations, seconds,
+			seconds > 0 ? operations / seconds : 0.0);
+}
+
+/**
+ * FUNCTION NAME: runBenchmark
+ *
+ * DESCRIPTION: Load keys, then time random reads of present and absent keys, updates, a full
+ * 				scan and deletes of half the keys, checking every result along the way
+ *
+ * RETURNS:
+ * false if the engine returned a wrong result
+ */
+static bool runBenchmark(const char *name, StorageEngine *engine, LSMEngine *lsm, unsigned long keys, size_t valueBytes) {
+	vector<unsigned long> order(keys);
+	for ( unsigned long i = 0; i < keys; i++ ) {
+		order[i] = i;
+	}
+	srand(1);
+	random_shuffle(order.begin(), order.end());
+	string value(valueBytes, 'v');
+	char key[32];
+	bool ok = true;
+	Slice found;
+
+	auto start = chrono::steady_clock::now();
+	for ( unsigned long i = 0; i < keys; i++ ) {
+		int length = sprintf(key, "key%08lu", order[i]);
+		ok = engine->insert(Slice(key, length), Slice(value), (unsigned char)(order[i] % 3)) && ok;
+	}
+	if ( lsm != NULL ) {
+		lsm->waitForIdle();
+	}
+	report(name, "insert", keys, elapsedSeconds(start));
+
+	start = chrono::steady_clock::now();
+	for ( unsigned long i = 0; i < keys; i++ ) {
+		int length = sprintf(key, "key%08lu", (unsigned long)rand() % keys);
+		ok = engine->lookup(Slice(key, length), &found) && found.size == valueBytes && ok;
+	}
+	report(name, "read", keys, elapsedSeconds(start));
+
+	start = chrono::steady_clock::now();
+	for ( unsigned long i = 0; i < keys; i++ ) {
+		int length = sprintf(key, "nokey%08lu", (unsigned long)rand() % keys);
+		ok = !engine->lookup(Slice(key, length), &found) && ok;
+	}
+	report(name, "read-miss", keys, elapsedSeconds(start));
+
+	value.assign(valueBytes, 'u');
+	start = chrono::steady_clock::now();
+	for ( unsigned long i = 0; i < keys; i++ ) {
+		int length = sprintf(key, "key%08lu", order[i]);
+		ok = engine->assign(Slice(key, length), Slice(value), (unsigned char)(order[i] % 3)) && ok;
+	}
+	if ( lsm != NULL ) {
+		lsm->waitForIdle();
+	}
+	report(name, "update", keys, elapsedSeconds(start));
+
+	unsigned long scanned = 0;
+	start = chrono::steady_clock::now();
+	engine->scan([&](const Slice &, const Slice &stored) {
+		scanned++;
+		ok = stored.size == valueBytes && stored.data[0] == 'u' && ok;
+	});
+	ok = scanned == keys && ok;
+	report(name, "scan", scanned, elapsedSeconds(start));
+
+	start = chrono::steady_clock::now();
+	for ( unsigned long i = 0; i < keys / 2; i++ ) {
+		int length = sprintf(key, "key%08lu", order[i]);
+		ok = engine->erase(Slice(key, length)) && ok;
+	}
+	if ( lsm != NULL ) {
+		lsm->waitForIdle();
+	}
+	report(name, "delete", keys / 2, elapsedSeconds(start));
+	ok = engine->size() == keys - keys / 2 && ok;
+
+	StorageStats stats;
+	engine->getStats(&stats);
+	printf("%-6s keys=%lu payload=%lu allocated=%lu reserved=%lu index=%lu disk=%lu\n", name, stats.keys,
+			stats.payloadBytes, stats.allocatedBytes, stats.reservedBytes, stats.indexBytes, stats.diskBytes);
+	printf("%-6s filter negatives=%lu false positives=%lu\n\n", name, stats.filterNegatives, stats.filterFalsePositives);
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long keys = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_KEYS;
+	size_t valueBytes = argc > 2 ? strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_VALUE_BYTES;
+	if ( keys == 0 || valueBytes == 0 ) {
+		printf("Usage: %s [keys] [value bytes]\n", argv[0]);
+		return 1;
+	}
+	bool ok = true;
+
+	MapEngine mapEngine;
+	ok = runBenchmark("map", &mapEngine, NULL, keys, valueBytes) && ok;
+	mapEngine.clear();
+
+	FlatHashEngine flatEngine;
+	ok = runBenchmark("flat", &flatEngine, NULL, keys, valueBytes) && ok;
+	flatEngine.clear();
+
+	LSMEngine lsmEngine(BENCH_LSM_DIRECTORY);
+	ok = runBenchmark("lsm", &lsmEngine, &lsmEngine, keys, valueBytes) && ok;
+
+	if ( !ok ) {
+		printf("FAILED: an engine returned a wrong result\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,82 @@
+/**********************************
+ * FILE NAME: StorageEngine.h
+ *
+ * DESCRIPTION: Interface implemented by the storage backends of HashTable
+ **********************************/
+
+#ifndef STORAGEENGINE_H_
+#define STORAGEENGINE_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include "Slice.h"
+
+// storage backends HashTable can be built on
+enum StorageEngineType {MAP_ENGINE, FLAT_HASH_ENGINE, LSM_ENGINE};
+
+/**
+ * STRUCT NAME: StorageStats
+ *
+ * DESCRIPTION: Memory footprint of a storage engine; sizes are in bytes
+ */
+struct StorageStats {
+	unsigned long keys;
+	// key and value bytes stored
+	unsigned long payloadBytes;
+	// bytes handed out to hold the keys and values
+	unsigned long allocatedBytes;
+	// bytes held from the system to hand out
+	unsigned long reservedBytes;
+	// hash index and per-record bookkeeping
+	unsigned long indexBytes;
+	unsigned long slabs;
+	// read-only files mapped into memory
+	unsigned long mappedBytes;
+	// table files written to disk
+	unsigned long diskBytes;
+	// lookups a Bloom filter answered without searching, and ones it sent on for nothing;
+	// the false positive rate is falsePositives / (negatives + falsePositives)
+	unsigned long filterNegatives;
+	unsigned long filterFalsePositives;
+};
+
+/**
+ * CLASS NAME: StorageEngine
+ *
+ * DESCRIPTION: A key => value byte store. Every operation is expected to locate the key
+ * 				at most once; callers must not read() before update() or erase(). A caller that
+ * 				needs the value being replaced or removed asks assign() or erase() for it.
+ * 				Each pair carries a one-byte tag (HashTable uses the ReplicaType) that the
+ * 				engine indexes so all pairs with one tag can be visited without a full scan.
+ */
+class StorageEngine {
+public:
+	// insert the pair if the key is absent; returns false if the key already exists
+	virtual bool insert(const Slice &key, const Slice &value, unsigned char tag) = 0;
+	// point value at the stored value of key; it stays valid until the engine is next called
+	// returns false if the key is absent
+	virtual bool lookup(const Slice &key, Slice *value) = 0;
+	// overwrite the value (and tag) of an existing key; returns false if the key is absent
+	// previous, if given, gets the value overwritten, found by the same probe
+	virtual bool assign(const Slice &key, const Slice &value, unsigned char tag, string *previous = NULL) = 0;
+	// remove the key; returns false if the key is absent. previous as for assign()
+	virtual bool erase(const Slice &key, string *previous = NULL) = 0;
+	virtual unsigned long size() = 0;
+	virtual void clear() = 0;
+	// call visit on every stored pair, in no particular order
+	virtual void scan(const function<void(const Slice &, const Slice &)> &visit) = 0;
+	// whether the slices scan() passes stay valid after visit returns, until the engine is next called
+	virtual bool scanSlicesOutlive() { return true; }
+	// call visit on every pair with the tag until visit returns false; visit must not modify the engine
+	virtual void scanTag(unsigned char tag, const function<bool(const Slice &, const Slice &)> &visit) = 0;
+	// number of pairs with the tag
+	virtual unsigned long countTag(unsigned char tag) = 0;
+	virtual void getStats(StorageStats *stats) = 0;
+	// give fragmented memory back if it is worth it; returns true if anything was done
+	virtual bool compact() { return false; }
+	virtual ~StorageEngine() {}
+};
+
+#endif /* STORAGEENGINE_H_ */
@@ -0,0 +1,108 @@
+/**********************************
+ * FILE NAME: TimerWheel.cpp
+ *
+ * DESCRIPTION: Definition of the TimerWheel class
+ **********************************/
+
+#include "TimerWheel.h"
+
+/**
+ * constructor
+ */
+TimerWheel::TimerWheel(int start): now(start), pending(0) {}
+
+/**
+ * Destructor
+ */
+TimerWheel::~TimerWheel() {}
+
+/**
+ * FUNCTION NAME: place
+ *
+ * DESCRIPTION: Put a timer in the lowest level whose span covers it, seen from the tick about to
+ * 				be processed. Timers already due go into that tick's level 0 slot.
+ */
+void TimerWheel::place(const Timer &timer, int reference) {
+	int64_t due = max(timer.expiresAt, reference);
+	int64_t delta = due - reference;
+	for ( int level = 0; level < TIMER_WHEEL_LEVELS; level++ ) {
+		int shift = TIMER_WHEEL_BITS * level;
+		if ( delta < ((int64_t)1 << (shift + TIMER_WHEEL_BITS)) ) {
+			slots[level][(due >> shift) & TIMER_WHEEL_MASK].push_back(timer);
+			return;
+		}
+	}
+	// Too far out: park it as far as the top level reaches
+	int shift = TIMER_WHEEL_BITS * (TIMER_WHEEL_LEVELS - 1);
+	due = reference + ((int64_t)1 << (shift + TIMER_WHEEL_BITS)) - 1;
+	slots[TIMER_WHEEL_LEVELS - 1][(due >> shift) & TIMER_WHEEL_MASK].push_back(timer);
+}
+
+/**
+ * FUNCTION NAME: cascade
+ *
+ * DESCRIPTION: Move the timers of the slot of level that time has reached one level down
+ */
+void TimerWheel::cascade(int level, int time) {
+	vector<Timer> moving;
+	moving.swap(slots[level][(time >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK]);
+	for ( size_t i = 0; i < moving.size(); i++ ) {
+		place(moving[i], time);
+	}
+}
+
+/**
+ * FUNCTION NAME: schedule
+ *
+ * DESCRIPTION: Fire key at expiresAt, or on the next advance if that time has passed
+ */
+void TimerWheel::schedule(const string &key, int expiresAt) {
+	Timer timer;
+	timer.key = key;
+	timer.expiresAt = expiresAt;
+	place(timer, now + 1);
+	pending++;
+}
+
+/**
+ * FUNCTION NAME: advance
+ *
+ * DESCRIPTION: Move the wheel to time, calling fire on every timer due by then in time order
+ */
+void TimerWheel::advance(int time, const function<void(const string &, int)> &fire) {
+	while ( now < time ) {
+		int tick = now + 1;
+		// When a level wraps, the level above hands down its next slot
+		for ( int level = 1; level < TIMER_WHEEL_LEVELS; level++ ) {
+			if ( ((tick >> (TIMER_WHEEL_BITS * (level - 1))) & TIMER_WHEEL_MASK) != 0 ) {
+				break;
+			}
+			cascade(level, tick);
+		}
+		vector<Timer> due;
+		due.swap(slots[0][tick & TIMER_WHEEL_MASK]);
+		now = tick;
+		pending -= due.size();
+		for ( size_t i = 0; i < due.size(); i++ ) {
+			fire(due[i].key, due[i].expiresAt);
+		}
+	}
+}
+
+unsigned long TimerWheel::size() const {
+	return pending;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drop every timer; the wheel keeps its time
+ */
+void TimerWheel::clear() {
+	for ( int level = 0; level < TIMER_WHEEL_LEVELS; level++ ) {
+		for ( int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++ ) {
+			vector<Timer>().swap(slots[level][slot]);
+		}
+	}
+	pending = 0;
+}
@@ -0,0 +1,54 @@
+/**********************************
+ * FILE NAME: TimerWheel.h
+ *
+ * DESCRIPTION: Header file of the TimerWheel class
+ **********************************/
+
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+/**
+ * CLASS NAME: TimerWheel
+ *
+ * DESCRIPTION: Hierarchical timer wheel of keys, driven by the simulation time.
+ * 				Level 0 has one slot per tick for the next TIMER_WHEEL_SLOTS ticks; every level
+ * 				above covers TIMER_WHEEL_SLOTS times more time per slot. When the lower level
+ * 				wraps, the next slot of the level above is cascaded down, so each timer moves at
+ * 				most TIMER_WHEEL_LEVELS times and advancing costs O(ticks + timers due).
+ * 				Timers further out than the top level can reach are parked in its last slot and
+ * 				placed again when it cascades.
+ * 				Timers are never cancelled: the owner checks a fired key is still due.
+ */
+class TimerWheel {
+private:
+	struct Timer {
+		string key;
+		int expiresAt;
+	};
+	vector<Timer> slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	// every timer due at or before this time has fired
+	int now;
+	unsigned long pending;
+
+	void place(const Timer &timer, int reference);
+	void cascade(int level, int time);
+public:
+	TimerWheel(int start = 0);
+	void schedule(const string &key, int expiresAt);
+	void advance(int time, const function<void(const string &, int)> &fire);
+	unsigned long size() const;
+	void clear();
+	virtual ~TimerWheel();
+};
+
+#endif /* TIMERWHEEL_H_ */
@@ -0,0 +1,75 @@
+/**********************************
+ * FILE NAME: Transfer.cpp
+ *
+ * DESCRIPTION: Definition of the bulk key transfer helpers
+ **********************************/
+
+#include "Transfer.h"
+
+/**
+ * constructor
+ */
+IncomingTransfer::IncomingTransfer(): next(0), lastActive(0) {}
+
+/**
+ * FUNCTION NAME: arrived
+ *
+ * DESCRIPTION: Record that the batch [start, end) arrived, moving next past every batch that
+ * 				now joins up with it
+ */
+void IncomingTransfer::arrived(size_t start, size_t end) {
+	if ( end <= next ) {
+		return;
+	}
+	size_t &known = received[start];
+	known = max(known, end);
+	while ( !received.empty() && received.begin()->first <= next ) {
+		next = max(next, received.begin()->second);
+		received.erase(received.begin());
+	}
+}
+
+/**
+ * FUNCTION NAME: appendTransferRecord
+ *
+ * DESCRIPTION: Append one record to a batch payload
+ */
+void appendTransferRecord(string *payload, uint32_t position, const string &key, const string &record) {
+	char prefix[TRANSFER_RECORD_PREFIX];
+	uint32_t keySize = (uint32_t)key.size();
+	uint32_t recordSize = (uint32_t)record.size();
+	memcpy(prefix, &position, sizeof(uint32_t));
+	memcpy(prefix + 4, &keySize, sizeof(uint32_t));
+	memcpy(prefix + 8, &recordSize, sizeof(uint32_t));
+	payload->append(prefix, TRANSFER_RECORD_PREFIX);
+	payload->append(key);
+	payload->append(record);
+}
+
+/**
+ * FUNCTION NAME: decodeTransferBatch
+ *
+ * DESCRIPTION: Walk the records of a batch payload; the slices point into payload
+ *
+ * RETURNS:
+ * false if a record runs past the end of the payload; the records before it were visited
+ */
+bool decodeTransferBatch(const string &payload, const function<void(uint32_t, const Slice &, const Slice &)> &visit) {
+	size_t offset = 0;
+	while ( offset < payload.size() ) {
+		if ( payload.size() - offset < TRANSFER_RECORD_PREFIX ) {
+			return false;
+		}
+		uint32_t position, keySize, recordSize;
+		memcpy(&position, &payload[offset], sizeof(uint32_t));
+		memcpy(&keySize, &payload[offset + 4], sizeof(uint32_t));
+		memcpy(&recordSize, &payload[offset + 8], sizeof(uint32_t));
+		offset += TRANSFER_RECORD_PREFIX;
+		if ( payload.size() - offset < (size_t)keySize + recordSize ) {
+			return false;
+		}
+		visit(position, Slice(&payload[offset], keySize), Slice(&payload[offset + keySize], recordSize));
+		offset += (size_t)keySize + recordSize;
+	}
+	return true;
+}
@@ -0,0 +1,80 @@
+/**********************************
+ * FILE NAME: Transfer.h
+ *
+ * DESCRIPTION: Bulk key transfer streams used to rebalance the ring
+ **********************************/
+
+#ifndef TRANSFER_H_
+#define TRANSFER_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include "Slice.h"
+#include "common.h"
+#include <deque>
+
+/*
+ * Macros
+ */
+// position, key size and record size in front of every record of a batch
+#define TRANSFER_RECORD_PREFIX 12
+// room left in a message for the header in front of the batch
+#define TRANSFER_HEADER_BYTES 64
+// batches of a stream sent but not acknowledged yet
+#define TRANSFER_WINDOW 4
+// ticks without progress before the unacknowledged batches are sent again
+#define TRANSFER_TIMEOUT 5
+// resends without progress before a stream is abandoned
+#define TRANSFER_MAX_RETRIES 10
+// ticks a receiver remembers a stream that has gone quiet
+#define TRANSFER_IDLE_TIMEOUT 100
+// stream id of a single batch sent without a stream: merged, never acknowledged
+#define TRANSFER_UNACKED_ID -1
+
+/**
+ * STRUCT NAME: OutgoingTransfer
+ *
+ * DESCRIPTION: Sending side of a stream of keys to one replica. The offset of a key is its
+ * 				position in keys. Records are read from the hash table as batches are built, so
+ * 				a key deleted in the meantime is skipped; a stream of hints carries its own.
+ */
+struct OutgoingTransfer {
+	Address to;
+	// replica type the receiver stores the keys as
+	ReplicaType replica;
+	vector<string> keys;
+	// records of the keys, to send in place of reading them from the hash table
+	vector<string> records;
+	// keys before acked are acknowledged; those in [acked, sent) are in flight
+	size_t acked;
+	size_t sent;
+	// end offsets of the batches in flight, oldest first
+	deque<size_t> batchEnds;
+	int lastProgress;
+	int retries;
+};
+
+/**
+ * CLASS NAME: IncomingTransfer
+ *
+ * DESCRIPTION: Receiving side of a stream. Batches may arrive out of order or twice; each is
+ * 				applied when it arrives, since storing a key again is harmless, and the stream is
+ * 				acknowledged up to the first offset not received yet.
+ */
+class IncomingTransfer {
+public:
+	// every offset before next has arrived
+	size_t next;
+	// batches [first, second) that arrived beyond next
+	map<size_t, size_t> received;
+	int lastActive;
+	IncomingTransfer();
+	void arrived(size_t start, size_t end);
+};
+
+// Batch payload: records of position | key size | record size | key | record, sizes 4 bytes each
+void appendTransferRecord(string *payload, uint32_t position, const string &key, const string &record);
+// call visit on each record of a payload; returns false if the payload is malformed
+bool decodeTransferBatch(const string &payload, const function<void(uint32_t, const Slice &, const Slice &)> &visit);
+
+#endif /* TRANSFER_H_ */
@@ -0,0 +1,163 @@
+/**********************************
+ * FILE NAME: WriteAheadLog.cpp
+ *
+ * DESCRIPTION: Definition of the WriteAheadLog class
+ **********************************/
+
+#include "WriteAheadLog.h"
+#include "Checksum.h"
+
+/**
+ * constructor
+ */
+WriteAheadLog::WriteAheadLog(const string &path): path(path), fd(-1), pendingRecords(0) {}
+
+/**
+ * Destructor
+ */
+WriteAheadLog::~WriteAheadLog() {
+	commit();
+	if ( fd >= 0 ) {
+		close(fd);
+	}
+}
+
+/**
+ * FUNCTION NAME: replay
+ *
+ * DESCRIPTION: Call apply on every intact record of an existing log, oldest first. Replay stops at
+ * 				the first short or corrupt record (a crash in the middle of a commit) and the file
+ * 				is truncated there. Must be called before open().
+ *
+ * RETURNS:
+ * number of records applied
+ */
+unsigned long WriteAheadLog::replay(const function<void(WalOp, const Slice &, const Slice &)> &apply) {
+	ifstream in(path.c_str(), ios::in | ios::binary);
+	if ( !in ) {
+		// Nothing logged yet
+		return 0;
+	}
+	string contents((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	in.close();
+
+	unsigned long applied = 0;
+	size_t offset = 0;
+	while ( offset + WAL_HEADER_SIZE <= contents.size() ) {
+		uint32_t length, crc;
+		memcpy(&length, &contents[offset], sizeof(uint32_t));
+		memcpy(&crc, &contents[offset + 4], sizeof(uint32_t));
+		if ( length < WAL_PAYLOAD_PREFIX || length > WAL_MAX_RECORD
+				|| offset + WAL_HEADER_SIZE + length > contents.size() ) {
+			break;
+		}
+		const char *payload = &contents[offset + WAL_HEADER_SIZE];
+		if ( crc32(payload, length) != crc ) {
+			break;
+		}
+		uint32_t keySize;
+		memcpy(&keySize, payload + 1, sizeof(uint32_t));
+		if ( keySize > length - WAL_PAYLOAD_PREFIX ) {
+			break;
+		}
+		Slice key(payload + WAL_PAYLOAD_PREFIX, keySize);
+		Slice value(payload + WAL_PAYLOAD_PREFIX + keySize, length - WAL_PAYLOAD_PREFIX - keySize);
+		apply(static_cast<WalOp>(payload[0]), key, value);
+		applied++;
+		offset += WAL_HEADER_SIZE + length;
+	}
+
+	if ( offset < contents.size() ) {
+		// Drop the torn tail so new records follow the last good one
+		truncate(path.c_str(), (off_t)offset);
+	}
+	return applied;
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Open the log for appending, creating it if needed
+ *
+ * RETURNS:
+ * false if the file cannot be opened
+ */
+bool WriteAheadLog::open() {
+	if ( fd < 0 ) {
+		fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	}
+	return fd >= 0;
+}
+
+/**
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Buffer one record; it reaches the disk at the next commit()
+ */
+void WriteAheadLog::append(WalOp op, const Slice &key, const Slice &value) {
+	uint32_t length = (uint32_t)(WAL_PAYLOAD_PREFIX + key.size + value.size);
+	uint32_t keySize = (uint32_t)key.size;
+	size_t start = pending.size();
+
+	pending.resize(start + WAL_HEADER_SIZE + length);
+	char *record = &pending[start];
+	memcpy(record, &length, sizeof(uint32_t));
+	char *payload = record + WAL_HEADER_SIZE;
+	payload[0] = (char)op;
+	memcpy(payload + 1, &keySize, sizeof(uint32_t));
+	memcpy(payload + WAL_PAYLOAD_PREFIX, key.data, key.size);
+	memcpy(payload + WAL_PAYLOAD_PREFIX + key.size, value.data, value.size);
+	uint32_t crc = crc32(payload, length);
+	memcpy(record + 4, &crc, sizeof(uint32_t));
+	pendingRecords++;
+}
+
+/**
+ * FUNCTION NAME: commit
+ *
+ * DESCRIPTION: Write every buffered record and fsync once for the whole batch
+ *
+ * RETURNS:
+ * false if the batch could not be made durable; it stays buffered for the next try
+ */
+bool WriteAheadLog::commit() {
+	if ( pendingRecords == 0 ) {
+		return true;
+	}
+	if ( !open() ) {
+		return false;
+	}
+	size_t written = 0;
+	while ( written < pending.size() ) {
+		ssize_t n = write(fd, pending.data() + written, pending.size() - written);
+		if ( n < 0 ) {
+			// Keep what is left for the next commit
+			pending.erase(0, written);
+			return false;
+		}
+		written += (size_t)n;
+	}
+	pending.clear();
+	pendingRecords = 0;
+	return fsync(fd) == 0;
+}
+
+/**
+ * FUNCTION NAME: reset
+ *
+ * DESCRIPTION: Drop every committed record, once a snapshot covers them. Records still
+ * 				buffered are kept for the next commit.
+ *
+ * RETURNS:
+ * false if the log could not be emptied
+ */
+bool WriteAheadLog::reset() {
+	if ( !open() ) {
+		return false;
+	}
+	return ftruncate(fd, 0) == 0 && fsync(fd) == 0;
+}
+
+const string &WriteAheadLog::getPath() {
+	return path;
+}
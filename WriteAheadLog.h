@@ -0,0 +1,52 @@
+/**********************************
+ * FILE NAME: WriteAheadLog.h
+ *
+ * DESCRIPTION: Header file of the WriteAheadLog class
+ **********************************/
+
+#ifndef WRITEAHEADLOG_H_
+#define WRITEAHEADLOG_H_
+
+#include "stdincludes.h"
+#include "Slice.h"
+
+/*
+ * Macros
+ */
+// record header: uint32 payload length | uint32 CRC-32 of the payload
+#define WAL_HEADER_SIZE 8
+// payload: uint8 op | uint32 key length | key bytes | value bytes
+#define WAL_PAYLOAD_PREFIX 5
+// refuse to replay a record claiming to be larger than this; the tail is treated as torn
+#define WAL_MAX_RECORD (1 << 24)
+
+enum WalOp {WAL_CREATE, WAL_UPDATE, WAL_DELETE};
+
+/**
+ * CLASS NAME: WriteAheadLog
+ *
+ * DESCRIPTION: Append-only redo log of the changes made to a node's hash table.
+ * 				append() only buffers the record; commit() writes the whole batch and
+ * 				fsyncs once (group commit), and is meant to be called once per tick.
+ * 				replay() re-applies a log left by an earlier run and cuts off a torn
+ * 				or corrupt tail, so appending can carry on after the last good record.
+ * 				Once a snapshot covers everything committed, reset() empties the log.
+ */
+class WriteAheadLog {
+private:
+	string path;
+	int fd;
+	string pending;
+	unsigned long pendingRecords;
+public:
+	WriteAheadLog(const string &path);
+	unsigned long replay(const function<void(WalOp, const Slice &, const Slice &)> &apply);
+	bool open();
+	void append(WalOp op, const Slice &key, const Slice &value);
+	bool commit();
+	bool reset();
+	const string &getPath();
+	virtual ~WriteAheadLog();
+};
+
+#endif /* WRITEAHEADLOG_H_ */
@@ -23,8 +23,14 @@ namespace {
 }
 
 // message types, reply is the message from node to coordinator
-enum MessageType {CREATE, READ, UPDATE, DELETE, REPLY, READREPLY};
-// enum of replica types
-enum ReplicaType {PRIMARY, SECONDARY, TERTIARY};
+// transfer carries a batch of keys to a new replica, which answers with a transfer ack
+// merkle carries Merkle tree digests between replicas for anti-entropy
+enum MessageType {CREATE, READ, UPDATE, DELETE, REPLY, READREPLY, TRANSFER, TRANSFERACK, MERKLE};
+// enum of replica types; with a replication factor over three the further replicas are
+// numbered on from TERTIARY, which the fixed underlying type allows
+enum ReplicaType : int {PRIMARY, SECONDARY, TERTIARY};
+// replicas a client operation waits for: CL_DEFAULT is READ_QUORUM for reads and WRITE_QUORUM
+// for writes, as the test case sets them
+enum ConsistencyLevel {CL_DEFAULT, CL_ONE, CL_QUORUM, CL_ALL};
 
 #endif
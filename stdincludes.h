@@ -10,7 +10,6 @@
 /*
  * Macros
  */
-#define RING_SIZE 512
 #define FAILURE -1
 #define SUCCESS 0
 
@@ -21,6 +20,7 @@
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 #include <time.h>
 #include <stdarg.h>
@@ -37,6 +37,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <unordered_map>
+#include <functional>
 
 using namespace std;
 